@@ -0,0 +1,101 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "debugView.hh"
+
+#include <algorithm>
+
+namespace {
+
+struct NamedView {
+  const char* name;
+  DebugView view;
+};
+
+const NamedView views[] = {
+  { "none", DebugView::None },
+  { "overdraw", DebugView::Overdraw },
+  { "shading", DebugView::Shading },
+  { "zreject", DebugView::ZReject },
+  { "lighting", DebugView::Lighting },
+};
+
+const int viewCount = sizeof(views) / sizeof(views[0]);
+
+// black for untouched pixels, then blue -> green -> yellow -> red
+void heat(float t, float* rgb) {
+  const float stops[][3] = {
+    { 0, 0, 1 }, { 0, 1, 0 }, { 1, 1, 0 }, { 1, 0, 0 }
+  };
+  float scaled = t * 3;
+  int i = std::min(2, (int)scaled);
+  float f = scaled - i;
+  for (int c = 0; c < 3; ++c)
+    rgb[c] = stops[i][c] + (stops[i + 1][c] - stops[i][c]) * f;
+}
+
+}
+
+bool parseDebugView(const std::string& name, DebugView& view) {
+  for (auto named : views) {
+    if (name == named.name) {
+      view = named.view;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* debugViewName(DebugView view) {
+  return views[(int)view].name;
+}
+
+DebugView nextDebugView(DebugView view) {
+  return views[((int)view + 1) % viewCount].view;
+}
+
+DebugCounters::DebugCounters(int width, int height)
+  : width(width), height(height),
+    overdraw(width * height), shading(width * height),
+    zreject(width * height), lighting(width * height) {}
+
+void DebugCounters::clear() {
+  std::fill(overdraw.begin(), overdraw.end(), 0);
+  std::fill(shading.begin(), shading.end(), 0);
+  std::fill(zreject.begin(), zreject.end(), 0);
+  std::fill(lighting.begin(), lighting.end(), 0);
+}
+
+const std::vector<unsigned int>& DebugCounters::counts(DebugView view) const {
+  switch (view) {
+  case DebugView::Shading:
+    return shading;
+  case DebugView::ZReject:
+    return zreject;
+  case DebugView::Lighting:
+    return lighting;
+  default:
+    return overdraw;
+  }
+}
+
+unsigned int DebugCounters::visualize(DebugView view, float* rgb) const {
+  const std::vector<unsigned int>& values = counts(view);
+  unsigned int maximum = *std::max_element(values.begin(), values.end());
+  for (std::size_t i = 0; i < values.size(); ++i) {
+    float* pixel = rgb + 3 * i;
+    if (values[i] == 0) {
+      pixel[0] = pixel[1] = pixel[2] = 0;
+      continue;
+    }
+    // a single hit is the coolest color so that 1x and 0x stay distinct
+    float t = maximum > 1 ? (float)(values[i] - 1) / (maximum - 1) : 0;
+    heat(t, pixel);
+  }
+  return maximum;
+}
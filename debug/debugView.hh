@@ -0,0 +1,50 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+// Alternate outputs that replace the shaded image with a false-color
+// picture of how much work went into each pixel
+enum class DebugView { None, Overdraw, Shading, ZReject, Lighting };
+
+// look up a view by its command line name, returns false if unknown
+bool parseDebugView(const std::string& name, DebugView& view);
+const char* debugViewName(DebugView view);
+DebugView nextDebugView(DebugView view);
+
+// Per-pixel counters collected during scan conversion
+class DebugCounters {
+public:
+  DebugCounters(int width, int height);
+
+  void clear();
+
+  // a fragment reached the depth test
+  void fragment(int x, int y) { ++overdraw[index(x, y)]; }
+  // the fragment lost the depth test
+  void rejected(int x, int y) { ++zreject[index(x, y)]; }
+  // the fragment was shaded using the given number of lights
+  void shaded(int x, int y, int lights) {
+    ++shading[index(x, y)];
+    lighting[index(x, y)] += lights;
+  }
+
+  // write the chosen view as an rgb image of width * height pixels
+  // returns the largest count, which maps to the hottest color
+  unsigned int visualize(DebugView view, float* rgb) const;
+
+private:
+  int width, height;
+  std::vector<unsigned int> overdraw, shading, zreject, lighting;
+
+  int index(int x, int y) const { return y * width + x; }
+  const std::vector<unsigned int>& counts(DebugView view) const;
+};
@@ -10,19 +10,55 @@
 #include "scan/activeEdgeTable.hh"
 #include "scan/color.hh"
 #include "scan/edge.hh"
+#include "scan/microTriangle.hh"
+#include "scan/pipeline.hh"
 #include "scan/polygon.hh"
+#include "scan/sampleBuffer.hh"
+#include "scan/shadingRate.hh"
+#include "scan/spanBuffer.hh"
+#include "scan/span.hh"
+#include "scan/trianglePlanes.hh"
 #include "scan/triangle.hh"
+#include "scan/visibilityBuffer.hh"
+#include "debug/debugView.hh"
+#include "scene/instances.hh"
+#include "scene/scene.hh"
+#include "scene/sceneDiff.hh"
+#include "scene/sceneLoader.hh"
+#include "scene/vertexTransform.hh"
+#include "scene/views.hh"
+#include "texture/texture.hh"
+#include "texture/virtualTexture.hh"
+#include "trace/trace.hh"
+#include "tween/tweenBatch.hh"
+#include "util/image.hh"
+#include "util/isa.hh"
+#include "util/broadcastRing.hh"
+#include "util/dragger.hh"
+#include "util/fileWatcher.hh"
+#include "util/frameStats.hh"
+#include "util/options.hh"
+#include "util/renderThread.hh"
+#include "util/sharedFrames.hh"
+#include "util/threadPool.hh"
 #include "util/vector2.hh"
+#include "util/videoSink.hh"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
+#include <functional>
+#include <future>
 #include <GL/glut.h>
 #include <iostream>
 #include <list>
 #include <limits>
 #include <math.h>
+#include <memory>
 #include <random>
 #include <string>
+#include <thread>
 #include <utility>
 #include <vector>
 
@@ -53,65 +89,123 @@ using namespace std;
 #define ImageW 400
 #define ImageH 400
 
-float framebuffer[ImageH][ImageW][3];
+// the frame being rendered: frameStorage headless, otherwise the back
+// buffer of the render thread
+float frameStorage[ImageH][ImageW][3];
+float (*framebuffer)[ImageW][3] = frameStorage;
 float ZMAX = 10000.0;	// NOTE: Assume no point has a Z value greater than 10000.0
-float zbuffer[ImageH][ImageW];
+DepthBuffer* zbuffer = nullptr;
 
 std::default_random_engine generator;
 std::uniform_real_distribution<float> distribution(0.0, 1.0);
 
 std::string sourcefile="triangle.dat";
 
-struct color {
-  float r, g, b;
-};
-
-struct light {
-  // Note: assume all lights are white
-  float x,y,z;		// x, y, z coordinates of light
-  color brightness;	// Level of brightness of light (0.0 - 1.0)
-};
-
-struct texture {
-  // Note access using getTextureRGB provided below
-  int xsize, ysize;	// The size of the texture in x and y
-  float* elements;	// RGB values
-};
-
-
-int numtriangles;		// The number of triangles in the scene
-int numlights;			// The number of lights (not including ambient) in the scene
-int numtextures;		// The number of textures used in the scene
-
-color ambientlight;		// The coefficient of ambient light
-
-triangle* trianglelist;	// Array of triangles
-light* lightlist;		// Array of lights
-texture* texturelist;	// Array of textures
-
-/* Pass in a pointer to the texture, t, and the texture coordinates, u and v
-   Returns (in R,G,B) the color of the texture at those coordinates */
-void getTextureRGB(texture* t, float u, float v, float& R, float& G, float& B) {
-  int xval,yval;
-  if (u<1.0) 
-    if (u>=0.0) xval = (int)(u*t->xsize);
-    else xval = 0;
-  else xval = t->xsize-1;
-  if (v<1.0) 
-    if (v>=0.0) yval = (int)(v*t->ysize);
-    else yval = 0;
-  else yval = t->ysize-1;
-        
-  R = t->elements[3*(xval*t->ysize+yval)];
-  G = t->elements[(3*(xval*t->ysize+yval))+1];
-  B = t->elements[(3*(xval*t->ysize+yval))+2];
-}
-
-
-// Draws the scene
+DebugView debugView = DebugView::None;
+DebugCounters debugCounters(ImageW, ImageH);
+
+// textures given inline in the scene file are converted to this format
+TextureFormat textureFormat = TextureFormat::Float;
+bool textureReport = false;
+
+// multisampled color and depth, resolved into the framebuffer after the
+// last triangle, only allocated when multisampling
+SampleBuffer* sampleBuffer = nullptr;
+
+// Adaptive shading is off while the threshold is 0
+float shadingThreshold = 0;
+struct ShadingRateStats {
+  long pixels, invocations;
+  int triangles[maxShadingRate + 1];	// by rate
+} shadingRateStats;
+
+// Triangles a few pixels across skip the edge tables when microLimit > 0,
+// see isMicroTriangle; triangles taking each path are counted per frame
+int microLimit;
+struct RasterPathStats {
+  long scanline, micro;
+} rasterPathStats;
+
+Scene scene;			// Triangles, lights and textures
+ThreadPool* pool;		// Runs scene loading jobs
+RenderThread* renderThread;	// Renders frames while GLUT presents them
+
+// With a camera, the scene is in world space and every frame renders its
+// transform into screen space instead
+bool cameraEnabled = false;
+Camera camera;
+Vector3 center;			// the model turns about this
+const float viewDepth = 1000;	// screen space depth of transformed scenes
+std::vector<triangle> viewTriangles;
+std::vector<light> viewLights;
+
+// Instances are placed every frame, skipping those out of view. Modes
+// taking the frame as one list of triangles get the scene's followed by
+// those of the instances placed; the serial path draws every instance
+// from a scratch list as it places it.
+std::vector<triangle> instancedTriangles;
+bool instancesListed;		// instancedTriangles holds the frame
+std::vector<triangle> instanceScratch;
+
+// Progressive rendering, used when progressive > 0. While input goes on,
+// frames render the scene scaled down by progressive into the bottom left
+// corner and scale the image up; once input settled for settleTime the
+// full frame follows, given up again by new input like any other.
+typedef std::chrono::steady_clock Clock;
+int progressive;
+const Clock::duration settleTime = std::chrono::milliseconds(200);
+std::atomic<Clock::rep> lastInput;	// time since the clock's epoch
+std::atomic<bool> previewNext(false);	// the next frame is a preview
+std::atomic<bool> unsettled(false);	// a full frame is still owed
+int previewScale = 1;		// the frame being rendered is scaled down by this
+bool previewing;		// previewTriangles holds the frame
+std::vector<triangle> previewTriangles;
+std::vector<light> previewLights;
+
+// Triangles and lights of the frame being rendered
+const std::vector<triangle>& frameTriangles() {
+  if (previewing)
+    return previewTriangles;
+  if (cameraEnabled)
+    return viewTriangles;
+  return instancesListed ? instancedTriangles : scene.triangles;
+}
+
+const std::vector<light>& frameLights() {
+  if (previewing)
+    return previewLights;
+  return cameraEnabled ? viewLights : scene.lights;
+}
+
+// Eye of the frame being rendered, scaled with the scene in previews
+Vector3 frameEye() {
+  Vector3 eye = { (float)ImageW / 2, (float)ImageH / 2, -ZMAX };
+  return previewing ? eye / (float)previewScale : eye;
+}
+
+// Sort-middle pipeline, used when rasterThreads > 0. The pool has a thread
+// for every stage, since the stages wait on each other.
+int setupThreads, rasterThreads;
+ThreadPool* pipelinePool;
+const std::size_t pipelineDepth = 64;	// setup records in flight
+
+// Triangle-parallel rendering, used when triangleThreads > 0
+int triangleThreads;
+ThreadPool* trianglePool;
+VisibilityBuffer* visibilityBuffer = nullptr;
+
+// Span buffer hidden surface removal, used when set
+SpanBuffer* spanBuffer = nullptr;
+bool spanReport = false;
+
+// the debug view the next frame is rendered with, set from the GLUT thread
+std::atomic<DebugView> requestedDebugView(DebugView::None);
+
+// Draws the latest finished frame
 void drawit(void)
 {
-  glDrawPixels(ImageW,ImageH,GL_RGB,GL_FLOAT,framebuffer);
+  TRACE_SCOPE("present");
+  glDrawPixels(ImageW,ImageH,GL_RGB,GL_FLOAT,renderThread->latest());
   glFlush();
 }
 
@@ -147,21 +241,17 @@ void setFramebuffer(Vector2 position, Color color) {
   framebuffer[position.y][position.x][2] = color.blue();
 }
 
-void setZbuffer(Vector2 position, float depth) {
-  repositionOrigin(position);
-  zbuffer[position.y][position.x] = depth;
-}
-
-int getDepth(Vector2 position) {
+// Passes when depth is nearer than the zbuffer, and stores it
+bool testAndSetZbuffer(Vector2 position, float depth) {
   repositionOrigin(position);
-  return zbuffer[position.y][position.x];
+  return zbuffer->testAndSet(position.x, position.y, depth);
 }
 
 Color calculateAndApplyIntensity(triangle tri, Vector3 pixel, Vector3 normal, Vector3 eye, Color color) {
   Color result = color;
-  Vector3 intensity;
+  Vector3 intensity = { 0, 0, 0 };
 
-  Vector3 ambient = { ambientlight.r, ambientlight.g, ambientlight.b };
+  Vector3 ambient = { scene.ambient.r, scene.ambient.g, scene.ambient.b };
   Vector3 diffuse;
   Vector3 specular;
 
@@ -178,10 +268,10 @@ Color calculateAndApplyIntensity(triangle tri, Vector3 pixel, Vector3 normal, Ve
   eye = normalize(eye - pixel);
   normal = normalize(normal);
 
-  for (int i = 0; i < numlights; ++i) {
-    light = { lightlist[i].x, lightlist[i].y, lightlist[i].z };
+  for (const auto& l : frameLights()) {
+    light = { l.x, l.y, l.z };
     light = normalize(light - pixel);
-    lightbrightness = { lightlist[i].brightness.r, lightlist[i].brightness.g, lightlist[i].brightness.b };
+    lightbrightness = { l.brightness.r, l.brightness.g, l.brightness.b };
     diffuse = lightbrightness;
     specular = lightbrightness;
     lightcos = fmax(0, dot(light, normal));
@@ -201,16 +291,38 @@ Color calculateAndApplyIntensity(triangle tri, Vector3 pixel, Vector3 normal, Ve
   return result;
 }
 
+// The texture of a triangle, or nullptr if it is untextured
+const texture* triangleTexture(triangle tri) {
+  if (tri.whichtexture < 0 || tri.whichtexture >= (int)scene.textures.size())
+    return nullptr;
+  return &scene.textures[tri.whichtexture];
+}
+
+// untextured triangles are white
 Color calculateAndApplyTextureUVs(triangle tri, Vector3 uv) {
+  const texture* t = triangleTexture(tri);
+  if (!t)
+    return { 1, 1, 1 };
   float x, y, z;
-  getTextureRGB(texturelist + tri.whichtexture, uv.x, uv.y, x, y, z);
+  getTextureRGB(t, uv.x, uv.y, x, y, z);
 
   return { x, y, z };
 }
 
+// Shaded color at any point of a triangle, from its attribute planes
+Vector3 shadeAt(triangle tri, const TrianglePlanes& planes, Vector3 eye, int x, int y) {
+  Vector3 pixel = { (float)x, (float)y, planes.zAt(x, y) };
+  Color color = calculateAndApplyTextureUVs(tri, planes.uvAt(x, y));
+  color = calculateAndApplyIntensity(tri, pixel, planes.normalAt(x, y), eye, color);
+  return { color.red(), color.green(), color.blue() };
+}
+
+// With coarse shading, pixels passing the depth test take their color
+// from the triangle's shading grid instead of being shaded one by one
 void drawScanLine(int y, int startX, int endX, int startZ, Vector3 startUV, Vector3 endUV,
                   Vector3 surfaceNormal, Vector3 startNormal, Vector3 endNormal,
-                  Vector3 eye, triangle tri) {
+                  Vector3 eye, triangle tri, CoarseShading* coarse = nullptr) {
+  TRACE_SCOPE("shadeSpan");
   Color color = { 0, 0, 0 };
   float z = startZ;
   float rangeX = endX - startX;
@@ -224,11 +336,31 @@ void drawScanLine(int y, int startX, int endX, int startZ, Vector3 startUV, Vect
   Vector3 pixel = { 0, 0, 0 };
   for (int x = startX; x < endX; ++x) {
     pixel = { (float)x, (float)y, (float)z };
-    if (z < getDepth({x, y})) {
-      setZbuffer({x, y}, z);
+    if (debugView != DebugView::None)
+      debugCounters.fragment(x, y);
+    bool visible = testAndSetZbuffer({x, y}, z);
+    if (visible && coarse) {
+      int invocations = coarse->getInvocations();
+      Vector3 rgb = coarse->colorAt(x, y, [&](int gridX, int gridY) {
+        return shadeAt(tri, coarse->getPlanes(), eye, gridX, gridY);
+      });
+      color = { rgb.x, rgb.y, rgb.z };
+      color.set_intensity(1);
+      setFramebuffer({x, y}, color);
+      ++shadingRateStats.pixels;
+      if (debugView != DebugView::None)
+        for (int i = invocations; i < coarse->getInvocations(); ++i)
+          debugCounters.shaded(x, y, frameLights().size());
+    } else if (visible) {
       color = calculateAndApplyTextureUVs(tri, currentUV);
       color = calculateAndApplyIntensity(tri, pixel, currentN, eye, color);
       setFramebuffer({x, y}, color);
+      ++shadingRateStats.pixels;
+      ++shadingRateStats.invocations;
+      if (debugView != DebugView::None)
+        debugCounters.shaded(x, y, frameLights().size());
+    } else if (debugView != DebugView::None) {
+      debugCounters.rejected(x, y);
     }
     if (rangeX != 0) {
       currentN += deltaN;
@@ -240,14 +372,167 @@ void drawScanLine(int y, int startX, int endX, int startZ, Vector3 startUV, Vect
   }
 }
 
+// Multisampled version of drawScanLine. Coverage and depth are tested per
+// sample, against the span's edges extended to the sample's row, but the
+// pixel is shaded once for all of its samples that pass.
+void drawScanLineMultisample(int y, Edge left, Edge right, Vector3 surfaceNormal,
+                             Vector3 eye, triangle tri) {
+  TRACE_SCOPE("shadeSpan");
+  if (y < 0 || y >= ImageH)
+    return;
+  int samples = sampleBuffer->getSamples();
+  const SampleOffset* offsets = samplePattern(samples);
+  float dzdx = surfaceNormal.z != 0 ? -surfaceNormal.x / surfaceNormal.z : 0;
+  float dzdy = surfaceNormal.z != 0 ? -surfaceNormal.y / surfaceNormal.z : 0;
+  float rangeX = right.currentX - left.currentX;
+  Vector3 deltaN = { 0, 0, 0 };
+  Vector3 deltaUV = { 0, 0, 0 };
+  if (rangeX != 0) {
+    deltaN = (right.currentN - left.currentN) / rangeX;
+    deltaUV = (right.currentUV - left.currentUV) / rangeX;
+  }
+
+  // samples lie within half a pixel of the row and of the pixel
+  int startX = std::max(0, (int)floor(left.currentX - fabs(left.xIncr) / 2 - 0.5f));
+  int endX = std::min(ImageW, (int)ceil(right.currentX + fabs(right.xIncr) / 2 + 0.5f));
+  Color color = { 0, 0, 0 };
+  for (int x = startX; x < endX; ++x) {
+    float z = left.currentZ + dzdx * (x - left.currentX);
+    bool covered = false;
+    unsigned mask = 0;
+    for (int s = 0; s < samples; ++s) {
+      SampleOffset offset = offsets[s];
+      float sampleX = x + offset.x;
+      if (sampleX < left.currentX + left.xIncr * offset.y ||
+          sampleX >= right.currentX + right.xIncr * offset.y)
+        continue;
+      covered = true;
+      float sampleZ = z + dzdx * offset.x + dzdy * offset.y;
+      if (sampleZ < sampleBuffer->getDepth(x, y, s)) {
+        sampleBuffer->setDepth(x, y, s, sampleZ);
+        mask |= 1u << s;
+      }
+    }
+    if (!covered)
+      continue;
+    if (debugView != DebugView::None)
+      debugCounters.fragment(x, y);
+    if (mask == 0) {
+      if (debugView != DebugView::None)
+        debugCounters.rejected(x, y);
+      continue;
+    }
+
+    float t = x - left.currentX;
+    Vector3 pixel = { (float)x, (float)y, z };
+    color = calculateAndApplyTextureUVs(tri, left.currentUV + deltaUV * t);
+    color = calculateAndApplyIntensity(tri, pixel, left.currentN + deltaN * t, eye, color);
+    float rgb[3] = { color.red(), color.green(), color.blue() };
+    sampleBuffer->write(x, y, mask, rgb);
+    if (debugView != DebugView::None)
+      debugCounters.shaded(x, y, frameLights().size());
+  }
+}
+
+// Picks the shading rate of a triangle, returning nullptr when it must be
+// shaded at every pixel
+CoarseShading* makeCoarseShading(triangle tri) {
+  TrianglePlanes planes = makeTrianglePlanes(tri);
+  int rate = 1;
+  if (planes.valid) {
+    rate = chooseShadingRate(shadingVariation(planes, tri, triangleTexture(tri), frameLights()),
+                             shadingThreshold);
+  }
+  ++shadingRateStats.triangles[rate];
+  if (rate == 1)
+    return nullptr;
+  float minX = std::min({ tri.v[0].x, tri.v[1].x, tri.v[2].x });
+  float minY = std::min({ tri.v[0].y, tri.v[1].y, tri.v[2].y });
+  float maxX = std::max({ tri.v[0].x, tri.v[1].x, tri.v[2].x });
+  float maxY = std::max({ tri.v[0].y, tri.v[1].y, tri.v[2].y });
+  return new CoarseShading(planes, rate, floor(minX), floor(minY), ceil(maxX), ceil(maxY));
+}
+
+// Screen space setup of a triangle whose view independent setup, along
+// with its lights and target, is already in material
+SetupRecord setupGeometry(triangle tri, const SpanKernelArgs& material) {
+  std::list<Edge> edges = makeEdges(tri);
+  SetupRecord record;
+  record.edgeTable = makeActiveEdgeTable(edges);
+  record.minY = findMinYFromEdges(edges);
+  record.maxY = findMaxYFromEdges(edges);
+  record.kernelArgs = material;
+  setupSpanGeometry(record.kernelArgs, tri, calculateNormal(edges, tri));
+  record.skip = false;
+  return record;
+}
+
+ShadingContext shadingContext(const std::vector<light>& lights) {
+  return { lights.data(), (int)lights.size(),
+           { scene.ambient.r, scene.ambient.g, scene.ambient.b }, frameEye() };
+}
+
+// View independent setup of a triangle for the specialized span kernels,
+// drawing into the current frame
+SpanKernelArgs triangleMaterial(triangle tri, unsigned id = 0) {
+  SpanKernelArgs material;
+  material.context = shadingContext(frameLights());
+  material.target = { &framebuffer[0][0][0], zbuffer, visibilityBuffer, spanBuffer, ImageW };
+  setupSpanMaterial(material, tri, triangleTexture(tri));
+  material.id = id;
+  return material;
+}
+
+// Setup of a triangle for the specialized span kernels
+SetupRecord setupTriangle(triangle tri, unsigned id = 0) {
+  return setupGeometry(tri, triangleMaterial(tri, id));
+}
+
+// Whether triangles go through the specialized kernels, which do not
+// count work for the debug views
+bool specializedPath(CoarseShading* coarse) {
+  return !sampleBuffer && !coarse && debugView == DebugView::None;
+}
+
 void scanfill(triangle tri) {
+  CoarseShading* coarse = nullptr;
+  if (shadingThreshold > 0 && !sampleBuffer)
+    coarse = makeCoarseShading(tri);
+  if (specializedPath(coarse) && microLimit > 0 && isMicroTriangle(tri, microLimit)) {
+    ++rasterPathStats.micro;
+    SpanKernelArgs args = triangleMaterial(tri);
+    setupSpanGeometry(args, tri, calculateNormal({}, tri));
+    rasterizeMicroTriangle(args, ImageW, ImageH);
+    return;
+  }
+  ++rasterPathStats.scanline;
+  if (specializedPath(coarse)) {
+    SetupRecord record = setupTriangle(tri);
+    TRACE_SCOPE("rasterize");
+    long pixels = rasterizeRows(record, [](int y) { return true; }, record.kernelArgs.kernel);
+    // full rate triangles under adaptive shading shade every pixel
+    if (shadingThreshold > 0) {
+      shadingRateStats.pixels += pixels;
+      shadingRateStats.invocations += pixels;
+    }
+    return;
+  }
+
   std::list<Edge> edges = makeEdges(tri);
   ActiveEdgeTable edgeTable = makeActiveEdgeTable(edges);
   ActiveEdgeList edgeList(findMinYFromEdges(edges));
   Vector3 normal = calculateNormal(edges, tri);
+  Vector3 eye = frameEye();
+
+  TRACE_SCOPE("rasterize");
   for (auto list : edgeTable) {
     edgeList.add(list);
     for (std::size_t i = 0; i < edgeList.size(); i += 2) {
+      if (sampleBuffer) {
+        drawScanLineMultisample(edgeList.getCurrentY(), edgeList[i], edgeList[i + 1], normal,
+                                eye, tri);
+        continue;
+      }
       drawScanLine(edgeList.getCurrentY(),
                    edgeList[i].currentX,
                    edgeList[i + 1].currentX,
@@ -257,10 +542,15 @@ void scanfill(triangle tri) {
                    normal,
                    edgeList[i].currentN,
                    edgeList[i + 1].currentN,
-                   { (float)ImageW / 2, (float)ImageH / 2, -ZMAX },
-                   tri);
+                   eye,
+                   tri,
+                   coarse);
     }
   }
+  if (coarse) {
+    shadingRateStats.invocations += coarse->getInvocations();
+    delete coarse;
+  }
 }
 
 // Normalizes the vector passed in
@@ -289,88 +579,889 @@ float angle(float x1, float y1, float z1, float x2, float y2, float z2) {
   return  acos(dot(x1,y1,z1,x2,y2,z2));
 }
 
-void display(void)
+// Textures load in the background, rendering waits only for the ones
+// its triangles use
+void waitForTexture(int i)
+{
+  if (!scene.waitForTexture(i)) {
+    cout << "Error! Could not read texture " << i << " of " << sourcefile << endl;
+    exit(-1);
+  }
+}
+
+// Prints how the tile cache of virtual textures served the last frame
+void reportTileCache(void)
+{
+  TileCacheStats stats = tileCacheStats();
+  if (stats.lookups == 0)
+    return;
+  cout << "Tile cache: " << stats.lookups << " lookups, "
+       << 100.0 * stats.hits / stats.lookups << "% hits, " << stats.misses << " misses, "
+       << stats.evictions << " evictions, " << stats.bytesLoaded << " bytes loaded, "
+       << stats.residentBytes << " of " << stats.budget << " bytes resident" << endl;
+  resetTileCacheStats();
+}
+
+// Prints how many shading evaluations adaptive shading saved last frame
+void reportShadingRate(void)
+{
+  ShadingRateStats& stats = shadingRateStats;
+  cout << "Adaptive shading: " << stats.invocations << " shading invocations for "
+       << stats.pixels << " pixels";
+  if (stats.pixels > 0)
+    cout << " (" << 100.0 * (stats.pixels - stats.invocations) / stats.pixels << "% saved)";
+  cout << ", triangles at 1x1/2x2/4x4: " << stats.triangles[1] << "/"
+       << stats.triangles[2] << "/" << stats.triangles[4] << endl;
+  stats = ShadingRateStats();
+}
+
+// Prints how many triangles took each rasterization path in a frame
+void reportRasterPaths(void)
+{
+  RasterPathStats& stats = rasterPathStats;
+  if (stats.scanline == 0 && stats.micro == 0)
+    return;
+  cout << "Raster paths: " << stats.scanline << " scanline, " << stats.micro
+       << " micro triangles" << endl;
+  stats = RasterPathStats();
+}
+
+// Sort-middle rendering of the whole scene. Setup threads turn triangles
+// into setup records in whatever order they finish; each raster thread
+// owns interleaved bands of rows and fills them from every record in
+// submission order, so every pixel sees triangles in the serial order.
+// Returns false when the frame went stale.
+bool scanfillPipelined(const std::function<bool()>& stale) {
+  long count = frameTriangles().size();
+  BroadcastRing<SetupRecord> records(pipelineDepth, rasterThreads);
+  std::atomic<long> next(0);
+  std::vector<std::future<void>> stages;
+
+  for (int s = 0; s < setupThreads; ++s) {
+    stages.push_back(pipelinePool->submit([&]() {
+      for (long i; (i = next++) < count;) {
+        const triangle& tri = frameTriangles()[i];
+        SetupRecord record;
+        if (!stale()) {
+          if (triangleTexture(tri))
+            waitForTexture(tri.whichtexture);
+          TRACE_SCOPE("setup");
+          record = setupTriangle(tri);
+        }
+        records.publish(i, std::move(record));
+      }
+    }));
+  }
+  for (int r = 0; r < rasterThreads; ++r) {
+    stages.push_back(pipelinePool->submit([&, r]() {
+      auto owns = [r](int y) {
+        return y >= 0 && y < ImageH && pipelineBandOwner(y, rasterThreads) == r;
+      };
+      for (long i = 0; i < count; ++i) {
+        const SetupRecord& record = records.at(i);
+        if (!record.skip && pipelineOverlaps(record, r, rasterThreads, ImageH)) {
+          TRACE_SCOPE("rasterize");
+          rasterizeRows(record, owns, record.kernelArgs.kernel);
+        }
+        records.release(i);
+      }
+    }));
+  }
+
+  for (auto& stage : stages)
+    stage.get();
+  return !stale();
+}
+
+// Triangle-parallel rendering of the whole scene. Threads take whole
+// triangles; a first pass finds the nearest triangle of every pixel in
+// the visibility buffer, and a second shades each pixel once, for that
+// triangle only. Returns false when the frame went stale.
+bool scanfillTriangleParallel(const std::function<bool()>& stale) {
+  long count = frameTriangles().size();
+  std::vector<SetupRecord> records(count);
+  visibilityBuffer->clear();
+
+  // runs pass(i) for every triangle across the pool
+  auto parallel = [&](const char* name, std::function<void(long)> pass) {
+    std::atomic<long> next(0);
+    std::vector<std::future<void>> threads;
+    for (int t = 0; t < triangleThreads; ++t) {
+      threads.push_back(trianglePool->submit([&]() {
+        TRACE_SCOPE(name);
+        for (long i; (i = next++) < count && !stale();)
+          pass(i);
+      }));
+    }
+    for (auto& thread : threads)
+      thread.get();
+  };
+
+  parallel("visibility", [&](long i) {
+    const triangle& tri = frameTriangles()[i];
+    if (triangleTexture(tri))
+      waitForTexture(tri.whichtexture);
+    records[i] = setupTriangle(tri, i);
+    rasterizeRows(records[i], [](int y) { return true; }, drawVisibilitySpan, "visibilitySpan");
+  });
+  if (stale())
+    return false;
+  parallel("resolve", [&](long i) {
+    rasterizeRows(records[i], [](int y) { return true; }, records[i].kernelArgs.resolveKernel);
+  });
+  return !stale();
+}
+
+// Span buffer rendering of the whole scene. A first pass inserts every
+// triangle's spans into the span buffer, which keeps only their visible
+// pieces; a second shades each piece once. Returns false when the frame
+// went stale.
+bool scanfillSpanBuffer(const std::function<bool()>& stale) {
+  std::vector<SetupRecord> records(frameTriangles().size());
+  spanBuffer->clear();
+  {
+    TRACE_SCOPE("spans");
+    for (std::size_t i = 0; i < records.size(); ++i) {
+      if (stale())
+        return false;
+      const triangle& tri = frameTriangles()[i];
+      if (triangleTexture(tri))
+        waitForTexture(tri.whichtexture);
+      records[i] = setupTriangle(tri, i);
+      rasterizeRows(records[i], [](int y) { return true; }, insertSpan, "insertSpan");
+    }
+  }
+  if (stale())
+    return false;
+  {
+    TRACE_SCOPE("resolve");
+    spanBuffer->forEachVisible([&](const SpanRecord& span, int y, int x0, int x1) {
+      drawVisiblePiece(records[span.id].kernelArgs, span, y, x0, x1);
+    });
+  }
+  if (spanReport) {
+    std::size_t pixels;
+    std::size_t pieces = spanBuffer->countPieces(pixels);
+    cout << "Span buffer: " << spanBuffer->getSpans() << " spans of "
+         << spanBuffer->getSpanPixels() << " pixels, " << pieces << " visible pieces of "
+         << pixels << " pixels shaded" << endl;
+  }
+  return true;
+}
+
+// Initialize framebuffer and zbuffer to clear
+void clearBuffers(void)
 {
-  for (int i = 0; i < numtriangles; ++i) {
-    scanfill(trianglelist[i]);
+  // compiles to memset, which the C library already picks per CPU
+  std::fill_n(&framebuffer[0][0][0], ImageH * ImageW * 3, 0.0f);
+  zbuffer->clear();
+  if (sampleBuffer)
+    sampleBuffer->clear(ZMAX);
+  if (debugView != DebugView::None)
+    debugCounters.clear();
+}
+
+// Hot reload. The watcher only flags the scene file as changed; the render
+// thread reloads it before its next frame, so no frame sees the scene
+// change under it.
+FileWatcher* watcher;
+std::atomic<bool> reloadRequested(false);
+// the last frame finished in full without a debug view, whose depth the
+// zbuffer still holds; null once a frame was given up
+const float* lastFrame;
+// what reloads changed since lastFrame
+bool reloaded;
+SceneDiff reloadDiff;
+
+// Loads the scene file again, keeping the textures that did not change.
+// A file that does not load, e.g. one caught half saved, leaves the scene
+// as it was.
+void reloadScene(void)
+{
+  TRACE_SCOPE("reload");
+  // the loader may still be writing textures of the old scene
+  for (std::size_t i = 0; i < scene.textures.size(); ++i)
+    scene.waitForTexture(i);
+  Scene next;
+  std::string error;
+  if (!loadScene(sourcefile, next, *pool, textureFormat, error, &scene)) {
+    cout << "Error! " << error << ", keeping the loaded scene" << endl;
+    return;
   }
+  SceneDiff diff = diffScenes(scene, next, ImageW, ImageH, DepthBuffer::tileSize);
+  scene = std::move(next);
+  cout << "Reloaded " << sourcefile << ": " << diff.changedTriangles << " of "
+       << scene.triangles.size() << " triangles changed, " << diff.keptTextures << " of "
+       << scene.textures.size() << " textures kept"
+       << (diff.lighting ? ", lighting changed" : "") << endl;
+  reloaded = true;
+  reloadDiff.lighting = reloadDiff.lighting || diff.lighting;
+  reloadDiff.region.add(diff.region);
+}
 
+// Whether the frame after a reload can start from the last one. Lighting
+// changes every pixel, and so does the camera, the only thing animated
+// while watching. Modes keeping buffers of their own rule it out too.
+bool canRenderRegion(void)
+{
+  return reloaded && lastFrame && !reloadDiff.lighting && !cameraEnabled && scene.instances.empty() &&
+         shadingThreshold <= 0 && specializedPath(nullptr) && triangleThreads == 0 &&
+         rasterThreads == 0 && !spanBuffer;
+}
+
+// Renders only the region a reload changed: the rest of the last frame is
+// copied, and the triangles overlapping the region are drawn again over
+// it with its depth cleared. Outside the region the depth test turns
+// every redrawn pixel away, as the nearest depth there is already stored
+// and ties go to the triangle drawn first.
+bool renderRegion(const Region& region, const std::function<bool()>& stale)
+{
+  TRACE_SCOPE("region");
+  float* target = &framebuffer[0][0][0];
+  if (lastFrame != target)
+    std::copy_n(lastFrame, ImageH * ImageW * 3, target);
+  for (int y = region.y0; y < region.y1; ++y)
+    std::fill(target + (y * ImageW + region.x0) * 3, target + (y * ImageW + region.x1) * 3, 0.0f);
+  if (!region.empty())
+    zbuffer->clear(region.x0, region.y0, region.x1, region.y1);
+
+  std::size_t drawn = 0;
+  for (const auto& tri : scene.triangles) {
+    if (!region.overlaps(triangleRegion(tri, ImageW, ImageH)))
+      continue;
+    if (stale())
+      return false;
+    if (triangleTexture(tri))
+      waitForTexture(tri.whichtexture);
+    scanfill(tri);
+    ++drawn;
+  }
+  cout << "Redrew " << region.area() << " of " << ImageW * ImageH << " pixels, " << drawn
+       << " of " << scene.triangles.size() << " triangles" << endl;
+  return true;
+}
+
+bool renderScene(const std::function<bool()>& stale);
+
+// Scales the triangles and lights of the frame down by previewScale about
+// the origin, as a smaller screen would hold them; frameEye scales the eye
+// along. Vertices are rounded to whole pixels, as the scan converter expects.
+void scalePreview(void)
+{
+  TRACE_SCOPE("preview");
+  float scale = 1.0f / previewScale;
+  previewTriangles = frameTriangles();
+  for (auto& tri : previewTriangles) {
+    for (auto& v : tri.v) {
+      v.x = std::round(v.x * scale), v.y = std::round(v.y * scale), v.z *= scale;
+    }
+  }
+  previewLights = frameLights();
+  for (auto& l : previewLights)
+    l.x *= scale, l.y *= scale, l.z *= scale;
+  previewing = true;
+}
+
+// Spreads the preview in the bottom left corner of target over the whole
+// screen, every pixel of it a block of previewScale by previewScale
+void upscalePreview(float* target)
+{
+  TRACE_SCOPE("upscale");
+  // from the last pixel back, so none of the preview is overwritten
+  // before it is read
+  for (int y = ImageH - 1; y >= 0; --y) {
+    for (int x = ImageW - 1; x >= 0; --x) {
+      const float* from = target + ((y / previewScale) * ImageW + x / previewScale) * 3;
+      float* to = target + (y * ImageW + x) * 3;
+      to[0] = from[0], to[1] = from[1], to[2] = from[2];
+    }
+  }
+}
+
+// Dragging with the left button turns the model, with a camera. The GLUT
+// thread drags; the render thread turns the model by what it has not yet.
+int dragX, dragY;
+Dragger dragger(dragX, dragY);
+std::atomic<int> draggedX(0);
+int turnedX;			// render thread
+const float degreesPerPixel = 0.5f;
+
+// Renders the scene into target, or the counters collected while
+// rendering it when a debug view is selected. Gives up between triangles,
+// returning false, once stale() says a newer frame was requested.
+bool render(float* target, const std::function<bool()>& stale)
+{
+  TRACE_SCOPE("frame");
+  framebuffer = (float (*)[ImageW][3])target;
+  debugView = requestedDebugView;
+  int dragged = draggedX;
+  camera.modelYaw += (dragged - turnedX) * degreesPerPixel;
+  turnedX = dragged;
+  if (reloadRequested.exchange(false))
+    reloadScene();
+  // redrawing only what a reload changed is quick enough in full
+  bool region = canRenderRegion();
+  previewScale = progressive > 0 && previewNext && !region ? progressive : 1;
+  bool done = region ? renderRegion(reloadDiff.region, stale) : renderScene(stale);
+  if (done && previewScale > 1)
+    upscalePreview(target);
+  lastFrame = done && debugView == DebugView::None && previewScale == 1 ? target : nullptr;
+  if (done) {
+    reloaded = false;
+    reloadDiff = SceneDiff();
+  }
+  return done;
+}
+
+// Fills instancedTriangles with the scene's triangles and those of the
+// instances whose box is visible
+void listInstances(const std::function<bool(const Box&)>& visible)
+{
+  TRACE_SCOPE("instances");
+  instancedTriangles = scene.triangles;
+  appendInstances(scene, visible, instancedTriangles);
+  instancesListed = true;
+}
+
+// Fills instancedTriangles with the scene's triangles and those of the
+// instances on screen, clipped to it
+void listOnScreen()
+{
+  TRACE_SCOPE("instances");
+  instancedTriangles = scene.triangles;
+  appendOnScreen(scene, { ImageW, ImageH, viewDepth }, instancedTriangles);
+  instancesListed = true;
+}
+
+// Places every instance on screen, clipped to it, and draws it, for the
+// serial path
+bool drawInstances(const std::function<bool()>& stale)
+{
+  Viewport viewport = { ImageW, ImageH, viewDepth };
+  for (const auto& instance : scene.instances) {
+    const Mesh& mesh = scene.meshes[instance.mesh];
+    if (mesh.triangles.empty())
+      continue;
+    Box bounds = instanceBounds(mesh, instance);
+    if (!boxOnScreen(bounds, ImageW, ImageH))
+      continue;
+    if (stale())
+      return false;
+    instanceScratch.clear();
+    placeOnScreen(mesh, instance, bounds, viewport, instanceScratch);
+    for (const auto& tri : instanceScratch) {
+      if (triangleTexture(tri))
+        waitForTexture(tri.whichtexture);
+      scanfill(tri);
+    }
+  }
+  return true;
+}
+
+bool renderScene(const std::function<bool()>& stale)
+{
+  // the parallel modes only run the specialized kernels
+  bool parallel = shadingThreshold <= 0 && specializedPath(nullptr);
+  bool listed = parallel && (spanBuffer || triangleThreads > 0 || rasterThreads > 0);
+  instancesListed = false;
+  previewing = false;
+  if (cameraEnabled) {
+    Viewport viewport = { ImageW, ImageH, viewDepth };
+    if (!scene.instances.empty()) {
+      Matrix4 clipFromScene = projectionMatrix(camera, viewport) * viewMatrix(camera) *
+                              modelMatrix(camera, center);
+      listInstances([&clipFromScene](const Box& box) { return boxInFrustum(box, clipFromScene); });
+    }
+    transformScene(instancesListed ? instancedTriangles : scene.triangles, scene.lights, camera,
+                   center, viewport, viewTriangles, viewLights);
+  } else if ((listed || previewScale > 1) && !scene.instances.empty()) {
+    listOnScreen();
+  }
+  if (previewScale > 1)
+    scalePreview();
+  clearBuffers();
+  if (parallel && spanBuffer) {
+    if (!scanfillSpanBuffer(stale))
+      return false;
+  } else if (parallel && triangleThreads > 0) {
+    if (!scanfillTriangleParallel(stale))
+      return false;
+  } else if (parallel && rasterThreads > 0) {
+    if (!scanfillPipelined(stale))
+      return false;
+  } else {
+    for (const auto& tri : frameTriangles()) {
+      if (stale())
+        return false;
+      if (triangleTexture(tri))
+        waitForTexture(tri.whichtexture);
+      scanfill(tri);
+    }
+    if (!cameraEnabled && !instancesListed && !drawInstances(stale))
+      return false;
+  }
+
+  if (sampleBuffer) {
+    TRACE_SCOPE("resolve");
+    sampleBuffer->resolve(&framebuffer[0][0][0]);
+  }
+
+  if (textureReport)
+    reportTileCache();
+  if (shadingThreshold > 0)
+    reportShadingRate();
+  if (microLimit > 0)
+    reportRasterPaths();
+
+  if (debugView != DebugView::None) {
+    unsigned int maximum = debugCounters.visualize(debugView, &framebuffer[0][0][0]);
+    cout << "Debug view " << debugViewName(debugView) << ": max " << maximum << " per pixel" << endl;
+  }
+  return true;
+}
+
+void display(void)
+{
   drawit();
 }
 
+// Notes input for progressive rendering: frames are previews until it
+// settles
+void noteInput(void)
+{
+  if (progressive == 0)
+    return;
+  lastInput = Clock::now().time_since_epoch().count();
+  previewNext = true;
+  unsettled = true;
+}
+
+// Asks for a frame showing what input changed
+void interacted(void)
+{
+  noteInput();
+  renderThread->request();
+}
+
+// Redisplays whenever the render thread finishes a frame, and asks for
+// the full frame once input settled
+void pollFrames(int value)
+{
+  if (renderThread->hasNewFrame())
+    glutPostRedisplay();
+  Clock::time_point input{ Clock::duration(lastInput) };
+  if (unsettled && Clock::now() - input >= settleTime) {
+    unsettled = false;
+    previewNext = false;
+    renderThread->request();
+  }
+  glutTimerFunc(16, pollFrames, 0);
+}
+
+// Animation frame loop. Tweens animate the scene and frames are rendered
+// at fps: in the window from a GLUT timer, headless back to back.
+TweenBatch animation;
+float fps;
+FrameStats* frameStats;
+bool degrade;
+float baseShadingThreshold;	// degrading never shades finer than this
+Clock::time_point nextTick;	// deadline of the next frame, GLUT thread
+Clock::time_point lastAnimated;	// render thread
+int framesSinceReport;	// render thread
+
+// Sweeps light i across the screen and back, forever
+void sweepLight(std::size_t i)
+{
+  light& l = scene.lights[i];
+  animation.add(&l.x, l.x < ImageW / 2 ? ImageW : 0, 2, Easing::SineInOut,
+                [i]() { sweepLight(i); });
+}
+
+// Turns the model about its center once every seconds, forever
+void turntable(float seconds)
+{
+  camera.modelYaw = 0;
+  animation.add(&camera.modelYaw, 360, seconds, Easing::Linear,
+                [seconds]() { turntable(seconds); });
+}
+
+// Coarsens shading after a missed deadline, and refines it again once
+// frames take less than half the budget. The parallel modes only shade in
+// full, and coarse shading would put the frame back on the serial path,
+// so with them degrading does nothing.
+void adaptShading(double ms)
+{
+  bool parallelMode = spanBuffer || triangleThreads > 0 || rasterThreads > 0;
+  if (parallelMode && baseShadingThreshold <= 0 && !sampleBuffer)
+    return;
+  double budget = frameStats->getBudget();
+  if (ms > budget)
+    shadingThreshold = std::min(4.0f, std::max(0.25f, shadingThreshold * 2));
+  else if (ms < budget / 2 && shadingThreshold > baseShadingThreshold)
+    shadingThreshold = shadingThreshold / 2 > 0.2f ? shadingThreshold / 2 : 0;
+  shadingThreshold = std::max(shadingThreshold, baseShadingThreshold);
+}
+
+// Advances the animation by delta seconds and renders a frame, recording
+// how long rendering took
+bool renderAnimationFrame(float* target, const std::function<bool()>& stale, float delta)
+{
+  animation.advance(delta);
+  Clock::time_point start = Clock::now();
+  if (!render(target, stale))
+    return false;
+  double ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+  frameStats->record(ms);
+  if (degrade)
+    adaptShading(ms);
+  return true;
+}
+
+// Render thread side of the windowed loop: animates by the time since the
+// last frame and reports the frame times every five seconds
+bool renderAnimated(float* target, const std::function<bool()>& stale)
+{
+  Clock::time_point now = Clock::now();
+  float delta = std::chrono::duration<float>(now - lastAnimated).count();
+  lastAnimated = now;
+  if (!renderAnimationFrame(target, stale, delta))
+    return false;
+  if (++framesSinceReport >= 5 * fps) {
+    frameStats->report(cout);
+    frameStats->reset();
+    framesSinceReport = 0;
+  }
+  return true;
+}
+
+// Asks for a frame every 1/fps seconds. A frame still rendering at the
+// next deadline is left to finish and the new one is dropped.
+void frameTick(int value)
+{
+  noteInput();
+  if (renderThread->busy())
+    frameStats->drop();
+  else
+    renderThread->request();
+
+  Clock::duration period = std::chrono::duration_cast<Clock::duration>(
+    std::chrono::duration<double>(1 / fps));
+  Clock::time_point now = Clock::now();
+  nextTick += period;
+  if (nextTick < now)
+    nextTick = now + period;	// fell behind; skip the missed ticks
+  int wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextTick - now).count();
+  glutTimerFunc(wait, frameTick, 0);
+}
+
+// 'v' cycles through the debug views
+void keyboard(unsigned char key, int x, int y)
+{
+  if (key == 'v') {
+    DebugView view = nextDebugView(requestedDebugView);
+    requestedDebugView = view;
+    cout << "Debug view " << debugViewName(view) << endl;
+    interacted();
+  }
+}
+
+void mouse(int button, int state, int x, int y)
+{
+  if (button == GLUT_LEFT_BUTTON && state == GLUT_DOWN)
+    dragger.start(x, y);
+}
+
+void motion(int x, int y)
+{
+  dragger.end(x, y);
+  dragger();
+  dragger.start(x, y);
+  draggedX = dragX;
+  interacted();
+}
+
+// Prints the memory held by each texture
+void reportTextureMemory(void)
+{
+  std::size_t total = 0;
+  std::size_t totalAsFloat = 0;
+  for (std::size_t i = 0; i < scene.textures.size(); ++i) {
+    waitForTexture(i);
+    const texture& t = scene.textures[i];
+    std::size_t asFloat = (std::size_t)t.xsize * t.ysize * 3 * sizeof(float);
+    cout << "Texture " << i << ": " << t.xsize << "x" << t.ysize << " "
+         << textureFormatName(t.format) << ", ";
+    if (t.tiles)
+      cout << "virtual, " << t.tiles->getTilesX() * t.tiles->getTilesY() << " tiles of "
+           << t.tiles->tileBytes() << " bytes (";
+    else
+      cout << textureBytes(t) << " bytes (";
+    cout << asFloat << " as float)" << endl;
+    total += textureBytes(t);
+    totalAsFloat += asFloat;
+  }
+  cout << "Textures: " << total << " bytes (" << totalAsFloat << " as float)" << endl;
+}
+
+// Loads the scene, returning as soon as its geometry is ready
 void init(void)
 {
-  int i,j,k;
+  std::string error;
+  if (!loadScene(sourcefile, scene, *pool, textureFormat, error)) {
+    cout << "Error! " << error << endl;
+    exit(-1);
+  }
 
-  // Initialize framebuffer to clear
-  for(i=0;i<ImageH;i++) {
-    for (j=0;j<ImageW;j++) {
-      framebuffer[i][j][0] = 0.0;
-      framebuffer[i][j][1] = 0.0;
-      framebuffer[i][j][2] = 0.0;
-      zbuffer[i][j] = ZMAX;
-    }
+  if (textureReport)
+    reportTextureMemory();
+  if (!scene.instances.empty()) {
+    std::size_t placed = 0;
+    for (const auto& instance : scene.instances)
+      placed += scene.meshes[instance.mesh].triangles.size();
+    cout << "Instances: " << scene.instances.size() << " of " << scene.meshes.size()
+         << " meshes, " << placed << " triangles once placed" << endl;
   }
+}
 
-  // Load in data
-  ifstream infile(sourcefile);
-  if (!infile) {
-    cout << "Error! Input file " << sourcefile << " does not exist!" << endl;
+// Places the camera and starts the animations asked for, once the scene
+// is loaded
+void setupView(const Options& options)
+{
+  if (options.camera) {
+    cameraEnabled = true;
+    center = sceneCenter(scene);
+    camera.eye = options.cameraEye;
+    camera.target = options.lookAtSet ? options.lookAt : center;
+    camera.fov = options.fov;
+    camera.modelYaw = options.modelYaw;
+  }
+  if (options.animateLights && options.watch) {
+    // the sweeps hold on to lights a reload replaces
+    cout << "Error! --animate-lights cannot be combined with --watch" << endl;
     exit(-1);
   }
-  infile >> numtriangles >> numlights >> numtextures;
-        
-  // First read triangles
-  trianglelist = new triangle[numtriangles];
-  for(i=0;i<numtriangles;i++) {
-    infile >> trianglelist[i].whichtexture;
-    infile >> trianglelist[i].kamb >> trianglelist[i].kdiff >> trianglelist[i].kspec;
-    infile >> trianglelist[i].shininess;
-    for(j=0;j<3;j++) {
-      infile >> trianglelist[i].v[j].x >> trianglelist[i].v[j].y >> trianglelist[i].v[j].z;
-      infile >> trianglelist[i].v[j].nx >> trianglelist[i].v[j].ny >> trianglelist[i].v[j].nz;
-      infile >> trianglelist[i].v[j].u >> trianglelist[i].v[j].v;
+  if (options.animateLights) {
+    for (std::size_t i = 0; i < scene.lights.size(); ++i)
+      sweepLight(i);
+  }
+  if (options.turntable > 0) {
+    if (!cameraEnabled) {
+      cout << "Error! --turntable needs a --camera" << endl;
+      exit(-1);
     }
+    turntable(options.turntable);
   }
+}
 
-  // Now read lights
-  lightlist = new light[numlights];
-  infile >> ambientlight.r >> ambientlight.g >> ambientlight.b;
-  for(i=0;i<numlights;i++) {
-    infile >> lightlist[i].x >> lightlist[i].y >> lightlist[i].z;
-    infile >> lightlist[i].brightness.r >> lightlist[i].brightness.g >> lightlist[i].brightness.b;
-  
-}
-
-  // Now read textures
-  texturelist = new texture[numtextures];
-  for(i=0;i<numtextures;i++) {
-    infile >> texturelist[i].xsize >> texturelist[i].ysize;
-    texturelist[i].elements = new float[texturelist[i].xsize*texturelist[i].ysize*3];
-    for(j=0;j<texturelist[i].xsize;j++) {
-      for (k=0;k<texturelist[i].ysize;k++) {
-        infile >> texturelist[i].elements[3*(j*texturelist[i].ysize+k)];
-        infile >> texturelist[i].elements[3*(j*texturelist[i].ysize+k)+1];
-        infile >> texturelist[i].elements[3*(j*texturelist[i].ysize+k)+2];
+// Renders every view to its own image, the views in parallel on the pool.
+// The material half of triangle setup is done once for the loaded scene,
+// with its instances placed; each view transforms the scene and
+// rasterizes it into its own buffers.
+void renderViews(const std::vector<View>& views, DepthFormat depthFormat)
+{
+  for (std::size_t i = 0; i < scene.textures.size(); ++i)
+    waitForTexture(i);
+  // instances are placed once for all views, none culled
+  const std::vector<triangle>* world = &scene.triangles;
+  if (!scene.instances.empty()) {
+    listInstances([](const Box& box) { return true; });
+    world = &instancedTriangles;
+  }
+  std::vector<SpanKernelArgs> materials(world->size());
+  for (std::size_t i = 0; i < materials.size(); ++i) {
+    const triangle& tri = (*world)[i];
+    materials[i].context = shadingContext(scene.lights);
+    setupSpanMaterial(materials[i], tri, triangleTexture(tri));
+    materials[i].id = 0;
+  }
+  center = sceneCenter(scene);
+
+  std::vector<std::future<bool>> written;
+  for (const View& view : views) {
+    written.push_back(pool->submit([&materials, &view, world, depthFormat]() {
+      TRACE_SCOPE("view");
+      Camera camera = view.camera;
+      if (!view.lookAtSet)
+        camera.target = center;
+      std::vector<triangle> triangles;
+      std::vector<light> lights;
+      std::vector<std::size_t> sources;
+      transformScene(*world, scene.lights, camera, center, { ImageW, ImageH, viewDepth },
+                     triangles, lights, &sources);
+      std::vector<float> color((std::size_t)ImageW * ImageH * 3, 0.0f);
+      DepthBuffer depth(ImageW, ImageH, depthFormat, ZMAX);
+      for (std::size_t i = 0; i < triangles.size(); ++i) {
+        SpanKernelArgs material = materials[sources[i]];
+        material.context.lights = lights.data();
+        material.target = { color.data(), &depth, nullptr, nullptr, ImageW };
+        SetupRecord record = setupGeometry(triangles[i], material);
+        rasterizeRows(record, [](int y) { return true; }, record.kernelArgs.kernel);
       }
+      return writePPM(view.output, color.data(), ImageW, ImageH);
+    }));
+  }
+  for (std::size_t i = 0; i < views.size(); ++i) {
+    if (!written[i].get()) {
+      cout << "Error! Could not write " << views[i].output << endl;
+      exit(-1);
     }
   }
+}
 
-  infile.close();
+// Chrome trace output, written when the program exits
+std::string traceFile;
+
+void writeTrace(void)
+{
+  if (!Trace::write(traceFile))
+    cout << "Error! Could not write " << traceFile << endl;
 }
 
 int main(int argc, char** argv)
 {
-  if (argc >= 2) {
-    sourcefile = std::string(argv[1]);
+  Options options = parseOptions(argc, argv);
+  // opened before anything is printed, as the video may take over stdout
+  std::unique_ptr<VideoSink> video;
+  if (!options.video.empty()) {
+    video.reset(new VideoSink(options.video, options.videoFormat, ImageW, ImageH, options.fps));
+    if (!video->valid()) {
+      cout << "Error! " << video->getError() << endl;
+      exit(-1);
+    }
+  }
+  Trace::setThreadName("main");
+  Isa isa = options.isaAuto ? detectIsa() : options.isa;
+  if (!isaSupported(isa)) {
+    cout << "Error! This CPU does not support " << isaName(isa) << endl;
+    exit(-1);
+  }
+  selectIsa(isa);
+  cout << "Kernels: " << isaName(isa) << (options.isaAuto ? " (detected)" : " (forced)") << endl;
+  sourcefile = options.sourcefile;
+  requestedDebugView = options.debugView;
+  textureFormat = options.textureFormat;
+  textureReport = options.textureReport;
+  setTileCacheBudget(options.tileCacheBytes);
+  pool = new ThreadPool(options.loadThreads);
+  shadingThreshold = options.shadingThreshold;
+  baseShadingThreshold = options.shadingThreshold;
+  fps = options.fps;
+  frameStats = new FrameStats(1000 / fps);
+  degrade = options.degrade;
+  setupThreads = options.setupThreads;
+  rasterThreads = options.rasterThreads;
+  if (rasterThreads > 0)
+    pipelinePool = new ThreadPool(setupThreads + rasterThreads);
+  triangleThreads = options.triangleThreads;
+  if (triangleThreads > 0) {
+    trianglePool = new ThreadPool(triangleThreads);
+    visibilityBuffer = new VisibilityBuffer(ImageW, ImageH);
+  }
+  zbuffer = new DepthBuffer(ImageW, ImageH, options.depthFormat, ZMAX);
+  if (options.spanBuffer)
+    spanBuffer = new SpanBuffer(ImageW, ImageH, ZMAX);
+  spanReport = options.spanReport;
+  microLimit = options.microTriangles;
+  progressive = options.progressive;
+  if (options.msaa > 1)
+    sampleBuffer = new SampleBuffer(ImageW, ImageH, options.msaa);
+  if (!options.trace.empty()) {
+    Trace::enable();
+    traceFile = options.trace;
+    atexit(writeTrace);
+  }
+
+  if (!options.views.empty()) {
+    std::vector<View> views;
+    std::string error;
+    if (!loadViews(options.views, views, error)) {
+      cout << "Error! " << error << endl;
+      exit(-1);
+    }
+    init();
+    renderViews(views, options.depthFormat);
+    return 0;
   }
+
+  if (!options.headless.empty() || !options.shm.empty() || !options.video.empty()) {
+    if (options.watch || options.progressive) {
+      cout << "Error! " << (options.watch ? "--watch" : "--progressive") << " needs the window"
+           << endl;
+      exit(-1);
+    }
+    init();
+    setupView(options);
+    float* target = &frameStorage[0][0][0];
+    std::unique_ptr<SharedFrameWriter> shm;
+    if (!options.shm.empty()) {
+      shm.reset(new SharedFrameWriter(options.shm, ImageW, ImageH, options.shmSlots));
+      if (!shm->valid()) {
+        cout << "Error! " << shm->getError() << endl;
+        exit(-1);
+      }
+    }
+    // headless frames step the animation by exactly one frame period;
+    // published ones are also paced at fps, and drawn right into the ring
+    Clock::time_point start = Clock::now();
+    for (int frame = 0; frame < options.frames; ++frame) {
+      if (shm) {
+        std::this_thread::sleep_until(start + std::chrono::duration_cast<Clock::duration>(
+                                        std::chrono::duration<float>(frame / fps)));
+        target = shm->begin();
+      }
+      renderAnimationFrame(target, []() { return false; }, frame ? 1 / fps : 0);
+      if (shm)
+        shm->commit();
+      if (video)
+        video->submit(target);
+    }
+    if (video && !video->finish()) {
+      cout << "Error! Could not write " << options.video << endl;
+      exit(-1);
+    }
+    if (options.frames > 1)
+      frameStats->report(cout);
+    if (!options.headless.empty() && !writePPM(options.headless, target, ImageW, ImageH)) {
+      cout << "Error! Could not write " << options.headless << endl;
+      exit(-1);
+    }
+    return 0;
+  }
+
   glutInit(&argc,argv);
   glutInitDisplayMode(GLUT_SINGLE|GLUT_RGB);
   glutInitWindowSize(ImageW,ImageH);
   glutInitWindowPosition(100,100);
   glutCreateWindow("Martin Fracker - Assignment 5");
   init();	
+  setupView(options);
+  // without anything animated, frames are only rendered when asked for
+  bool animated = !animation.empty();
+  lastAnimated = Clock::now();
+  renderThread = new RenderThread(ImageW, ImageH, options.frameBuffers,
+                                  animated ? renderAnimated : render);
+  renderThread->request();
+  if (options.watch) {
+    watcher = new FileWatcher(sourcefile, []() {
+      reloadRequested = true;
+      interacted();
+    });
+    if (!watcher->valid()) {
+      cout << "Error! " << watcher->getError() << endl;
+      exit(-1);
+    }
+  }
   glutDisplayFunc(display);
+  glutKeyboardFunc(keyboard);
+  if (cameraEnabled) {
+    glutMouseFunc(mouse);
+    glutMotionFunc(motion);
+  }
+  glutTimerFunc(16, pollFrames, 0);
+  if (animated) {
+    nextTick = Clock::now();
+    glutTimerFunc(0, frameTick, 0);
+  }
   glutMainLoop();
   return 0;
 }
@@ -17,6 +17,7 @@
 #include "edge.hh"
 #include "triangle.hh"
 #include "util/vector2.hh"
+#include "trace/trace.hh"
 #include "util/vector3.hh"
 
 struct ActiveEdgeTable {
@@ -40,6 +41,8 @@ struct ActiveEdgeTable {
 
   auto begin() { return edgeLists.begin(); }
   auto end() { return edgeLists.end(); }
+  auto begin() const { return edgeLists.cbegin(); }
+  auto end() const { return edgeLists.cend(); }
 
 private:
   std::vector<std::list<Edge>> edgeLists;
@@ -141,6 +144,7 @@ inline void setupUVInterpolation(std::list<Edge>& edges, triangle tri) {
 }
 
 inline std::list<Edge> makeEdges(triangle tri) {
+  TRACE_SCOPE("makeEdges");
   std::list<Edge> edges;
   std::vector<Vector3> points = { getTriangleVertex(tri, 0),
                                   getTriangleVertex(tri, 1),
@@ -175,6 +179,7 @@ inline int findMinYFromEdges(std::list<Edge> edges) {
 }
 
 inline ActiveEdgeTable makeActiveEdgeTable(std::list<Edge> edges) {
+  TRACE_SCOPE("makeActiveEdgeTable");
   int maxY = findMaxYFromEdges(edges);
   int minY = findMinYFromEdges(edges);
   ActiveEdgeTable table({minY, maxY});
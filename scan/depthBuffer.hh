@@ -0,0 +1,174 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// How depth is stored: 32 bit float, or 24 and 16 bit fixed point
+// spanning [0, farthest]
+enum class DepthFormat { Float32, Fixed24, Fixed16 };
+
+inline bool parseDepthFormat(const std::string& name, DepthFormat& format) {
+  if (name == "float32")
+    format = DepthFormat::Float32;
+  else if (name == "fixed24")
+    format = DepthFormat::Fixed24;
+  else if (name == "fixed16")
+    format = DepthFormat::Fixed16;
+  else
+    return false;
+  return true;
+}
+
+// Depth buffer cleared in O(tiles): clearing only marks every tile as
+// cleared, and a tile's memory is first filled when something is written
+// to it. Tests against a cleared tile never touch its depth values.
+class DepthBuffer {
+public:
+  static const int tileSize = 8;
+
+  DepthBuffer(int width, int height, DepthFormat format, float farthest)
+    : width(width), height(height), format(format), farthest(farthest),
+      tilesX((width + tileSize - 1) / tileSize),
+      tilesY((height + tileSize - 1) / tileSize),
+      cleared(tilesX * tilesY, 1) {
+    switch (format) {
+    case DepthFormat::Float32: floats.resize(width * height); break;
+    case DepthFormat::Fixed24: fixed24.resize(3 * width * height); break;
+    case DepthFormat::Fixed16: fixed16.resize(width * height); break;
+    }
+  }
+
+  float getFarthest() const { return farthest; }
+
+  void clear() {
+    std::fill(cleared.begin(), cleared.end(), 1);
+  }
+
+  // clears the tiles holding pixels [x0, x1) x [y0, y1)
+  void clear(int x0, int y0, int x1, int y1) {
+    for (int ty = y0 / tileSize; ty * tileSize < y1; ++ty)
+      std::fill(&cleared[ty * tilesX + x0 / tileSize],
+                &cleared[ty * tilesX + (x1 - 1) / tileSize] + 1, 1);
+  }
+
+  // Passes when z is nearer than the stored depth, which it then replaces.
+  // Fixed point formats compare z after quantizing it.
+  bool testAndSet(int x, int y, float z) {
+    int tile = tileOf(x, y);
+    int i = y * width + x;
+    switch (format) {
+    case DepthFormat::Float32:
+      if (cleared[tile] ? !(z < farthest) : !(z < floats[i]))
+        return false;
+      materialize(tile);
+      floats[i] = z;
+      return true;
+    case DepthFormat::Fixed24: {
+      std::uint32_t q = quantize(z, maxFixed24);
+      if (cleared[tile] ? q >= maxFixed24 : q >= load24(i))
+        return false;
+      materialize(tile);
+      store24(i, q);
+      return true;
+    }
+    case DepthFormat::Fixed16: {
+      std::uint32_t q = quantize(z, maxFixed16);
+      if (cleared[tile] ? q >= maxFixed16 : q >= fixed16[i])
+        return false;
+      materialize(tile);
+      fixed16[i] = (std::uint16_t)q;
+      return true;
+    }
+    }
+    return false;
+  }
+
+  // stored depth, converted back to z
+  float get(int x, int y) const {
+    if (cleared[tileOf(x, y)])
+      return farthest;
+    int i = y * width + x;
+    switch (format) {
+    case DepthFormat::Fixed24: return load24(i) * farthest / maxFixed24;
+    case DepthFormat::Fixed16: return fixed16[i] * farthest / maxFixed16;
+    default: return floats[i];
+    }
+  }
+
+private:
+  static const std::uint32_t maxFixed24 = (1u << 24) - 1;
+  static const std::uint32_t maxFixed16 = (1u << 16) - 1;
+
+  int width, height;
+  DepthFormat format;
+  float farthest;
+  int tilesX, tilesY;
+  // bytes rather than bits, so threads writing different tiles never
+  // share a flag's memory
+  std::vector<unsigned char> cleared;
+  std::vector<float> floats;
+  std::vector<unsigned char> fixed24;	// 3 bytes per pixel, low byte first
+  std::vector<std::uint16_t> fixed16;
+
+  int tileOf(int x, int y) const {
+    return (y / tileSize) * tilesX + x / tileSize;
+  }
+
+  std::uint32_t load24(int i) const {
+    const unsigned char* p = &fixed24[3 * i];
+    return p[0] | (std::uint32_t)p[1] << 8 | (std::uint32_t)p[2] << 16;
+  }
+
+  void store24(int i, std::uint32_t q) {
+    unsigned char* p = &fixed24[3 * i];
+    p[0] = (unsigned char)q;
+    p[1] = (unsigned char)(q >> 8);
+    p[2] = (unsigned char)(q >> 16);
+  }
+
+  std::uint32_t quantize(float z, std::uint32_t maximum) const {
+    if (!(z > 0))
+      return 0;
+    if (z >= farthest)
+      return maximum;
+    return (std::uint32_t)(z / farthest * maximum + 0.5f);
+  }
+
+  // fill a cleared tile with the far plane before its first write
+  void materialize(int tile) {
+    if (!cleared[tile])
+      return;
+    cleared[tile] = 0;
+    int x0 = (tile % tilesX) * tileSize;
+    int y0 = (tile / tilesX) * tileSize;
+    int x1 = std::min(width, x0 + tileSize);
+    int y1 = std::min(height, y0 + tileSize);
+    // a copy, std::fill takes its value by reference
+    std::uint16_t far16 = maxFixed16;
+    for (int y = y0; y < y1; ++y) {
+      int row = y * width;
+      switch (format) {
+      case DepthFormat::Float32:
+        std::fill(&floats[row + x0], &floats[row + x1], farthest);
+        break;
+      case DepthFormat::Fixed24:
+        // every byte of the far plane is 0xff
+        std::fill(&fixed24[3 * (row + x0)], &fixed24[3 * (row + x1)], 0xff);
+        break;
+      case DepthFormat::Fixed16:
+        std::fill(&fixed16[row + x0], &fixed16[row + x1], far16);
+        break;
+      }
+    }
+  }
+};
@@ -0,0 +1,105 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "scan/span.hh"
+#include "scan/triangle.hh"
+#include "util/vector3.hh"
+
+// Fast path for triangles a few pixels across. Building edges, an active
+// edge table and list costs far more than such a triangle's pixels, so it
+// is rasterized straight from its bounding box instead: every pixel is
+// tested against the three edge functions, and each row's covered run is
+// shaded by the triangle's span kernel in one call.
+
+// whether tri's bounding box is at most limit pixels wide and high
+inline bool isMicroTriangle(const triangle& tri, int limit) {
+  const vertex* v = tri.v;
+  float width = std::max({ v[0].x, v[1].x, v[2].x }) - std::min({ v[0].x, v[1].x, v[2].x });
+  float height = std::max({ v[0].y, v[1].y, v[2].y }) - std::min({ v[0].y, v[1].y, v[2].y });
+  return width <= limit && height <= limit;
+}
+
+namespace MicroTriangle {
+
+// twice the signed area of a, b, p: positive with p left of a to b
+inline float edge(const vertex& a, const vertex& b, float x, float y) {
+  return (b.x - a.x) * (y - a.y) - (b.y - a.y) * (x - a.x);
+}
+
+// Pixels exactly on an edge belong to one of the two triangles sharing
+// it: the one seeing it go down, or left when it is horizontal
+inline bool ownsEdge(const vertex& a, const vertex& b) {
+  return b.y < a.y || (b.y == a.y && b.x < a.x);
+}
+
+}
+
+// Rasterizes tri, already set up in args, into a width by height target.
+// Pixels are sampled at their integer coordinates, as the spans do.
+inline void rasterizeMicroTriangle(const SpanKernelArgs& args, int width, int height) {
+  using namespace MicroTriangle;
+  const vertex* v = args.tri.v;
+  float area = edge(v[0], v[1], v[2].x, v[2].y);
+  if (area == 0)
+    return;
+  // edges in the order that makes the inside positive
+  const vertex* a = &v[0];
+  const vertex* b = area > 0 ? &v[1] : &v[2];
+  const vertex* c = area > 0 ? &v[2] : &v[1];
+  const vertex* from[3] = { a, b, c };
+  const vertex* to[3] = { b, c, a };
+  bool owns[3];
+  for (int i = 0; i < 3; ++i)
+    owns[i] = ownsEdge(*from[i], *to[i]);
+
+  auto covered = [&](int x, int y) {
+    for (int i = 0; i < 3; ++i) {
+      float e = edge(*from[i], *to[i], (float)x, (float)y);
+      if (e < 0 || (e == 0 && !owns[i]))
+        return false;
+    }
+    return true;
+  };
+  // attributes at x, y from barycentric weights of the original vertices
+  auto at = [&](int x, int y, float& z, Vector3& uv, Vector3& n) {
+    float w0 = edge(v[1], v[2], (float)x, (float)y) / area;
+    float w1 = edge(v[2], v[0], (float)x, (float)y) / area;
+    float w2 = 1 - w0 - w1;
+    z = w0 * v[0].z + w1 * v[1].z + w2 * v[2].z;
+    uv = Vector3{ v[0].u, v[0].v, 0 } * w0 + Vector3{ v[1].u, v[1].v, 0 } * w1 +
+         Vector3{ v[2].u, v[2].v, 0 } * w2;
+    n = Vector3{ v[0].nx, v[0].ny, v[0].nz } * w0 + Vector3{ v[1].nx, v[1].ny, v[1].nz } * w1 +
+        Vector3{ v[2].nx, v[2].ny, v[2].nz } * w2;
+  };
+
+  int minX = std::max(0, (int)std::ceil(std::min({ v[0].x, v[1].x, v[2].x })));
+  int maxX = std::min(width - 1, (int)std::floor(std::max({ v[0].x, v[1].x, v[2].x })));
+  int minY = std::max(0, (int)std::ceil(std::min({ v[0].y, v[1].y, v[2].y })));
+  int maxY = std::min(height - 1, (int)std::floor(std::max({ v[0].y, v[1].y, v[2].y })));
+  for (int y = minY; y <= maxY; ++y) {
+    // a triangle covers one run per row
+    int start = minX;
+    while (start <= maxX && !covered(start, y))
+      ++start;
+    if (start > maxX)
+      continue;
+    int end = start + 1;
+    while (end <= maxX && covered(end, y))
+      ++end;
+    float startZ, endZ;
+    Vector3 startUV, endUV, startN, endN;
+    at(start, y, startZ, startUV, startN);
+    at(end, y, endZ, endUV, endN);
+    args.kernel(args, y, start, end, (int)startZ, startUV, endUV, startN, endN);
+  }
+}
@@ -0,0 +1,74 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <algorithm>
+
+#include "activeEdgeList.hh"
+#include "activeEdgeTable.hh"
+#include "span.hh"
+#include "trace/trace.hh"
+
+// Everything the raster stage needs of a triangle, produced by the setup
+// stage of the sort-middle pipeline
+struct SetupRecord {
+  ActiveEdgeTable edgeTable = ActiveEdgeTable({ 0, 0 });
+  int minY = 0, maxY = 0;
+  SpanKernelArgs kernelArgs;
+  bool skip = true;	// nothing to draw, e.g. setup of a stale frame
+};
+
+// Screen rows are split into bands of this many rows, dealt round-robin
+// to the raster threads. A multiple of the depth buffer tile size, so no
+// depth tile is shared by two raster threads.
+const int pipelineBandRows = 16;
+
+inline int pipelineBandOwner(int y, int rasterThreads) {
+  return (y / pipelineBandRows) % rasterThreads;
+}
+
+// whether any row of the record is in a band of owner
+inline bool pipelineOverlaps(const SetupRecord& record, int owner, int rasterThreads,
+                             int height) {
+  int last = std::min(record.maxY, height - 1);
+  for (int y = std::max(record.minY, 0); y <= last;
+       y = (y / pipelineBandRows + 1) * pipelineBandRows) {
+    if (pipelineBandOwner(y, rasterThreads) == owner)
+      return true;
+  }
+  return false;
+}
+
+// Walks the edges of a record from its lowest row exactly like scanfill,
+// running kernel over only the rows owns(y) accepts, so the pixels
+// written match the serial path whichever thread writes them. Each span
+// is traced as name; returns the pixels of the spans, before depth testing.
+template <typename Owns>
+long rasterizeRows(const SetupRecord& record, Owns owns, SpanKernel kernel,
+                   const char* name = "shadeSpan") {
+  long pixels = 0;
+  ActiveEdgeList edgeList(record.minY);
+  for (const auto& list : record.edgeTable) {
+    edgeList.add(list);
+    int y = edgeList.getCurrentY();
+    if (!owns(y))
+      continue;
+    for (std::size_t i = 0; i < edgeList.size(); i += 2) {
+      Edge left = edgeList[i];
+      Edge right = edgeList[i + 1];
+      int startX = left.currentX;
+      int endX = right.currentX;
+      TRACE_SCOPE(name);
+      kernel(record.kernelArgs, y, startX, endX, left.currentZ,
+             left.currentUV, right.currentUV, left.currentN, right.currentN);
+      pixels += std::max(endX - startX, 0);
+    }
+  }
+  return pixels;
+}
@@ -0,0 +1,116 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+// Position of a sample relative to the point a pixel is sampled at
+// without multisampling, in pixels
+struct SampleOffset {
+  float x, y;
+};
+
+// The usual rotated grid patterns for 2, 4 and 8 samples
+inline const SampleOffset* samplePattern(int samples) {
+  static const SampleOffset one[] = { { 0, 0 } };
+  static const SampleOffset two[] = { { 0.25f, 0.25f }, { -0.25f, -0.25f } };
+  static const SampleOffset four[] = {
+    { -0.125f, -0.375f }, { 0.375f, -0.125f }, { -0.375f, 0.125f }, { 0.125f, 0.375f }
+  };
+  static const SampleOffset eight[] = {
+    { 0.0625f, -0.1875f }, { -0.0625f, 0.1875f }, { 0.3125f, 0.0625f }, { -0.1875f, -0.3125f },
+    { -0.3125f, 0.3125f }, { -0.4375f, -0.0625f }, { 0.1875f, 0.4375f }, { 0.4375f, -0.4375f }
+  };
+  switch (samples) {
+  case 2: return two;
+  case 4: return four;
+  case 8: return eight;
+  default: return one;
+  }
+}
+
+// Color and depth for every sample of every pixel. Depth is always kept
+// per sample, but a pixel whose samples were all last written together
+// keeps a single color and only expands to one color per sample once a
+// triangle covers part of it.
+class SampleBuffer {
+public:
+  SampleBuffer(int width, int height, int samples)
+    : width(width), height(height), samples(samples),
+      fullMask(samples >= 32 ? ~0u : (1u << samples) - 1),
+      depth(width * height * samples), color(width * height * 3),
+      expanded(width * height, -1) {}
+
+  int getSamples() const { return samples; }
+  unsigned getFullMask() const { return fullMask; }
+
+  void clear(float farthest) {
+    std::fill(depth.begin(), depth.end(), farthest);
+    std::fill(color.begin(), color.end(), 0.0f);
+    std::fill(expanded.begin(), expanded.end(), -1);
+    pool.clear();
+  }
+
+  float getDepth(int x, int y, int sample) const {
+    return depth[pixel(x, y) * samples + sample];
+  }
+
+  void setDepth(int x, int y, int sample, float value) {
+    depth[pixel(x, y) * samples + sample] = value;
+  }
+
+  // store rgb in the samples selected by mask
+  void write(int x, int y, unsigned mask, const float rgb[3]) {
+    int p = pixel(x, y);
+    if (mask == fullMask) {
+      // fully covered pixels go back to a single color
+      std::copy(rgb, rgb + 3, &color[3 * p]);
+      expanded[p] = -1;
+      return;
+    }
+    if (expanded[p] < 0) {
+      expanded[p] = pool.size();
+      for (int s = 0; s < samples; ++s)
+        pool.insert(pool.end(), &color[3 * p], &color[3 * p] + 3);
+    }
+    float* sampleColors = &pool[expanded[p]];
+    for (int s = 0; s < samples; ++s)
+      if (mask & (1u << s))
+        std::copy(rgb, rgb + 3, sampleColors + 3 * s);
+  }
+
+  // average the samples of every pixel into a width * height rgb image
+  void resolve(float* rgb) const {
+    for (int p = 0; p < width * height; ++p) {
+      if (expanded[p] < 0) {
+        std::copy(&color[3 * p], &color[3 * p] + 3, rgb + 3 * p);
+        continue;
+      }
+      const float* sampleColors = &pool[expanded[p]];
+      for (int c = 0; c < 3; ++c) {
+        float sum = 0;
+        for (int s = 0; s < samples; ++s)
+          sum += sampleColors[3 * s + c];
+        rgb[3 * p + c] = sum / samples;
+      }
+    }
+  }
+
+private:
+  int width, height, samples;
+  unsigned fullMask;
+  std::vector<float> depth;	// samples per pixel
+  std::vector<float> color;	// rgb of pixels that are not expanded
+  std::vector<int> expanded;	// -1, or where the pixel's sample colors start in pool
+  std::vector<float> pool;	// rgb per sample of expanded pixels
+
+  int pixel(int x, int y) const { return y * width + x; }
+};
@@ -0,0 +1,116 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "scene/scene.hh"
+#include "trianglePlanes.hh"
+#include "util/vector3.hh"
+
+// Adaptive shading: a triangle whose lighting barely changes from pixel
+// to pixel is shaded on a coarse screen-aligned grid of rate x rate
+// pixel cells and the colors in between are interpolated.
+const int maxShadingRate = 4;
+
+// Estimated change in shaded color from one pixel to the next, from how
+// fast the texture, the normal and the direction to each light change
+inline float shadingVariation(const TrianglePlanes& planes, triangle tri,
+                              const texture* t, const std::vector<light>& lights) {
+  // a single texel is a flat color
+  float texels = 0;
+  if (t && t->xsize * t->ysize > 1) {
+    float texelsX = std::max(std::fabs(planes.duvdx.x), std::fabs(planes.duvdy.x)) * t->xsize;
+    float texelsY = std::max(std::fabs(planes.duvdx.y), std::fabs(planes.duvdy.y)) * t->ysize;
+    texels = std::max(texelsX, texelsY);
+  }
+
+  // highlights sharpen with the exponent, so weight it in
+  float sensitivity = tri.kdiff + tri.kspec * tri.shininess;
+  float normal = magnitude(planes.dndx) + magnitude(planes.dndy);
+
+  // a point light's direction turns by about 1 / distance per pixel
+  Vector3 centroid = {
+    (tri.v[0].x + tri.v[1].x + tri.v[2].x) / 3,
+    (tri.v[0].y + tri.v[1].y + tri.v[2].y) / 3,
+    (tri.v[0].z + tri.v[1].z + tri.v[2].z) / 3
+  };
+  float direction = 0;
+  for (const auto& l : lights) {
+    float distance = magnitude(Vector3{ l.x, l.y, l.z } - centroid);
+    float brightness = std::max(l.brightness.r, std::max(l.brightness.g, l.brightness.b));
+    if (distance > 0)
+      direction += brightness / distance;
+  }
+
+  return texels + sensitivity * (normal + direction);
+}
+
+// the coarsest rate whose interpolation error stays under threshold
+inline int chooseShadingRate(float variation, float threshold) {
+  for (int rate = maxShadingRate; rate > 1; rate /= 2)
+    if (variation * rate <= threshold)
+      return rate;
+  return 1;
+}
+
+// Shaded colors at the grid points of one triangle, computed on demand.
+// Pixels take the bilinear blend of the four grid points around them.
+class CoarseShading {
+public:
+  CoarseShading(const TrianglePlanes& planes, int rate, int minX, int minY, int maxX, int maxY)
+    : planes(planes), rate(rate), originX(floorTo(minX)), originY(floorTo(minY)),
+      columns((maxX - originX) / rate + 2), rows((maxY - originY) / rate + 2),
+      colors(columns * rows), shaded(columns * rows, false), invocations(0) {}
+
+  const TrianglePlanes& getPlanes() const { return planes; }
+  // grid points shaded so far
+  int getInvocations() const { return invocations; }
+
+  // shade(x, y) returns the color at a grid point
+  template <typename Shade>
+  Vector3 colorAt(int x, int y, Shade shade) {
+    int column = (x - originX) / rate;
+    int row = (y - originY) / rate;
+    float fx = (float)(x - originX - column * rate) / rate;
+    float fy = (float)(y - originY - row * rate) / rate;
+    Vector3 bottom = gridColor(column, row, shade) * (1 - fx) +
+                     gridColor(column + 1, row, shade) * fx;
+    Vector3 top = gridColor(column, row + 1, shade) * (1 - fx) +
+                  gridColor(column + 1, row + 1, shade) * fx;
+    return bottom * (1 - fy) + top * fy;
+  }
+
+private:
+  TrianglePlanes planes;
+  int rate, originX, originY, columns, rows;
+  std::vector<Vector3> colors;
+  std::vector<bool> shaded;
+  int invocations;
+
+  int floorTo(int value) const {
+    return value >= 0 ? value / rate * rate : -((-value + rate - 1) / rate * rate);
+  }
+
+  template <typename Shade>
+  Vector3 gridColor(int column, int row, Shade shade) {
+    // spans may reach slightly past the triangle's bounding box
+    column = std::max(0, std::min(columns - 1, column));
+    row = std::max(0, std::min(rows - 1, row));
+    int i = row * columns + column;
+    if (!shaded[i]) {
+      colors[i] = shade(originX + column * rate, originY + row * rate);
+      shaded[i] = true;
+      ++invocations;
+    }
+    return colors[i];
+  }
+};
@@ -0,0 +1,278 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "scan/depthBuffer.hh"
+#include "scan/spanBuffer.hh"
+#include "scan/visibilityBuffer.hh"
+#include "scene/scene.hh"
+#include "texture/texture.hh"
+#include "triangle.hh"
+#include "util/clamp.hh"
+#include "util/isa.hh"
+#include "util/vector3.hh"
+#include "util/vectorBatch.hh"
+
+// Span fill specialized at compile time on the features a triangle uses,
+// so the inner loop carries no per-pixel feature tests. Every variant
+// computes exactly what the generic drawScanLine does for such a triangle.
+
+// What the span writes into
+struct SpanTarget {
+  float* color;	// rgb rows of width pixels
+  DepthBuffer* depth;
+  VisibilityBuffer* visibility;	// only for triangle-parallel rendering
+  SpanBuffer* spans;	// only for span buffer rendering
+  int width;
+};
+
+// Lighting shared by every triangle
+struct ShadingContext {
+  const light* lights;
+  int numLights;
+  Vector3 ambient;
+  Vector3 eye;
+};
+
+// How a kernel tells which pixels of its span to shade
+enum class SpanTest {
+  Depth,	// those passing the depth test
+  Owner,	// those the visibility buffer gave the triangle
+  None,	// all of them, the span buffer already found them visible
+};
+
+struct SpanKernelArgs;
+typedef void (*SpanKernel)(const SpanKernelArgs&, int y, int startX, int endX, int startZ,
+                           Vector3 startUV, Vector3 endUV, Vector3 startN, Vector3 endN);
+
+// Per triangle setup, done once in scanfill
+struct SpanKernelArgs {
+  triangle tri;
+  const texture* t;	// null when the color is constant
+  Vector3 constantColor;	// texel color when the texture is a single texel
+  Vector3 flatNormal;	// normalized, when all vertex normals agree
+  float deltaZ;	// depth step per pixel
+  ShadingContext context;
+  SpanTarget target;
+  SpanKernel kernel;
+  // triangle-parallel rendering: the triangle's number in the scene, and
+  // its kernel shading the pixels the visibility buffer gave it
+  unsigned id;
+  SpanKernel resolveKernel;
+  // span buffer rendering: its kernel shading pieces known to be visible
+  SpanKernel visibleKernel;
+};
+
+// Phong intensity, following calculateAndApplyIntensity operation for
+// operation. Lights < 0 loops over context.numLights.
+template <bool Specular, int Lights>
+inline Vector3 spanIntensity(const SpanKernelArgs& args, Vector3 pixel, Vector3 normal) {
+  const triangle& tri = args.tri;
+  Vector3 intensity = { 0, 0, 0 };
+  Vector3 ambient = args.context.ambient;
+  ambient *= tri.kamb;
+  intensity += ambient;
+
+  Vector3 eye = normalize(args.context.eye - pixel);
+  int count = Lights >= 0 ? Lights : args.context.numLights;
+  for (int i = 0; i < count; ++i) {
+    const light& l = args.context.lights[i];
+    Vector3 direction = normalize(Vector3{ l.x, l.y, l.z } - pixel);
+    Vector3 brightness = { l.brightness.r, l.brightness.g, l.brightness.b };
+    float lightcos = std::fmax(0, dot(direction, normal));
+    Vector3 diffuse = brightness;
+    diffuse *= tri.kdiff * lightcos;
+    if (Specular) {
+      Vector3 reflect = normalize(2 * lightcos * normal - direction);
+      float reflectcos = std::fmax(0, dot(reflect, eye));
+      Vector3 specular = brightness;
+      specular *= tri.kspec * std::pow(reflectcos, tri.shininess);
+      if (lightcos == 0)
+        specular = 0;
+      intensity += diffuse + specular;
+    } else {
+      intensity += diffuse;
+    }
+  }
+  return intensity;
+}
+
+// Always inlined, so each instruction set variant below compiles the loop
+// with its own instructions.
+template <SpanTest Test, bool Textured, bool Specular, int Lights, bool Flat>
+inline __attribute__((always_inline)) void drawSpan(const SpanKernelArgs& args, int y, int startX, int endX, int startZ,
+              Vector3 startUV, Vector3 endUV, Vector3 startN, Vector3 endN) {
+  float z = startZ;
+  float rangeX = endX - startX;
+  Vector3 deltaN = (endN - startN) / rangeX;
+  Vector3 deltaUV = (endUV - startUV) / rangeX;
+  Vector3 currentN = startN;
+  Vector3 currentUV = startUV;
+  Vector3 texel = args.constantColor;
+  float* color = args.target.color + 3 * (y * args.target.width + startX);
+
+  // smooth normals are interpolated a chunk ahead and normalized together
+  const int chunk = 64;
+  float nx[chunk], ny[chunk], nz[chunk];
+  Vector3Batch normals = { nx, ny, nz };
+  for (int chunkX = startX; chunkX < endX; chunkX += chunk) {
+    int chunkEnd = std::min(endX, chunkX + chunk);
+    if (!Flat) {
+      for (int i = 0; i < chunkEnd - chunkX; ++i, currentN += deltaN)
+        normals.set(i, currentN);
+      normalize(normals, normals, chunkEnd - chunkX);
+    }
+    for (int x = chunkX; x < chunkEnd; ++x, color += 3) {
+      if (Test == SpanTest::Owner ? args.target.visibility->owner(x, y) == args.id
+          : Test == SpanTest::Depth ? args.target.depth->testAndSet(x, y, z) : true) {
+        if (Textured)
+          getTextureRGB(args.t, currentUV.x, currentUV.y, texel.x, texel.y, texel.z);
+        Vector3 pixel = { (float)x, (float)y, z };
+        Vector3 normal = Flat ? args.flatNormal : normals.get(x - chunkX);
+        Vector3 intensity = clamp(0, 1, spanIntensity<Specular, Lights>(args, pixel, normal));
+        color[0] = texel.x * intensity.x;
+        color[1] = texel.y * intensity.y;
+        color[2] = texel.z * intensity.z;
+      }
+      if (Textured)
+        currentUV += deltaUV;
+      z -= args.deltaZ;
+    }
+  }
+}
+
+#define A5_SPAN_VARIANT(name, target) \
+  template <SpanTest Test, bool Textured, bool Specular, int Lights, bool Flat> \
+  target void name(const SpanKernelArgs& args, int y, int startX, int endX, int startZ, \
+                   Vector3 startUV, Vector3 endUV, Vector3 startN, Vector3 endN) { \
+    drawSpan<Test, Textured, Specular, Lights, Flat>(args, y, startX, endX, startZ, \
+                                                         startUV, endUV, startN, endN); \
+  }
+
+#if A5_ISA_VARIANTS
+A5_SPAN_VARIANT(drawSpanSSE42, A5_TARGET_SSE42)
+A5_SPAN_VARIANT(drawSpanAVX2, A5_TARGET_AVX2)
+A5_SPAN_VARIANT(drawSpanAVX512, A5_TARGET_AVX512)
+#endif
+
+#undef A5_SPAN_VARIANT
+
+// First pass of triangle-parallel rendering: only offers the triangle's
+// depth to the visibility buffer, stepping z exactly like drawSpan
+inline void drawVisibilitySpan(const SpanKernelArgs& args, int y, int startX, int endX,
+                               int startZ, Vector3, Vector3, Vector3, Vector3) {
+  float z = startZ;
+  float farthest = args.target.depth->getFarthest();
+  for (int x = startX; x < endX; ++x) {
+    // nothing at or past the far plane passes the depth test
+    if (z < farthest)
+      args.target.visibility->test(x, y, z, args.id);
+    z -= args.deltaZ;
+  }
+}
+
+// First pass of span buffer rendering: inserts the triangle's span,
+// keeping what the other kernels need to shade any piece of it
+inline void insertSpan(const SpanKernelArgs& args, int y, int startX, int endX, int startZ,
+                       Vector3 startUV, Vector3 endUV, Vector3 startN, Vector3 endN) {
+  args.target.spans->insert(y, { args.id, startX, endX, (float)startZ, args.deltaZ,
+                                 startUV, endUV, startN, endN });
+}
+
+// Second pass of span buffer rendering: shades pixels [x0, x1) of span,
+// a piece of it found visible, with its attributes interpolated to the
+// ends of the piece
+inline void drawVisiblePiece(const SpanKernelArgs& args, const SpanRecord& span, int y,
+                             int x0, int x1) {
+  float range = span.endX - span.startX;
+  float t0 = (x0 - span.startX) / range;
+  float t1 = (x1 - span.startX) / range;
+  args.visibleKernel(args, y, x0, x1, (int)span.depth(x0),
+                     lerp(span.startUV, span.endUV, t0), lerp(span.startUV, span.endUV, t1),
+                     lerp(span.startN, span.endN, t0), lerp(span.startN, span.endN, t1));
+}
+
+namespace SpanDispatch {
+
+template <SpanTest Test, bool Textured, bool Specular, int Lights, bool Flat>
+SpanKernel variant(Isa isa) {
+#if A5_ISA_VARIANTS
+  switch (isa) {
+  case Isa::SSE42: return &drawSpanSSE42<Test, Textured, Specular, Lights, Flat>;
+  case Isa::AVX2: return &drawSpanAVX2<Test, Textured, Specular, Lights, Flat>;
+  case Isa::AVX512: return &drawSpanAVX512<Test, Textured, Specular, Lights, Flat>;
+  default: break;
+  }
+#endif
+  return &drawSpan<Test, Textured, Specular, Lights, Flat>;
+}
+
+template <SpanTest Test, bool Textured, bool Specular, int Lights>
+SpanKernel flat(bool isFlat, Isa isa) {
+  return isFlat ? variant<Test, Textured, Specular, Lights, true>(isa)
+                : variant<Test, Textured, Specular, Lights, false>(isa);
+}
+
+// lights are specialized up to 4, more loop over the count
+template <SpanTest Test, bool Textured, bool Specular>
+SpanKernel lights(int count, bool isFlat, Isa isa) {
+  switch (count) {
+  case 0: return flat<Test, Textured, Specular, 0>(isFlat, isa);
+  case 1: return flat<Test, Textured, Specular, 1>(isFlat, isa);
+  case 2: return flat<Test, Textured, Specular, 2>(isFlat, isa);
+  case 3: return flat<Test, Textured, Specular, 3>(isFlat, isa);
+  case 4: return flat<Test, Textured, Specular, 4>(isFlat, isa);
+  default: return flat<Test, Textured, Specular, -1>(isFlat, isa);
+  }
+}
+
+template <SpanTest Test>
+SpanKernel pick(bool textured, bool hasSpecular, int count, bool isFlat, Isa isa) {
+  if (textured)
+    return hasSpecular ? lights<Test, true, true>(count, isFlat, isa)
+                       : lights<Test, true, false>(count, isFlat, isa);
+  return hasSpecular ? lights<Test, false, true>(count, isFlat, isa)
+                     : lights<Test, false, false>(count, isFlat, isa);
+}
+
+}
+
+// The part of a triangle's setup that looks the same from every view: its
+// texture, material and span kernel. args.context must be filled in.
+// t may be null for an untextured, white triangle.
+inline void setupSpanMaterial(SpanKernelArgs& args, triangle tri, const texture* t) {
+  args.tri = tri;
+  args.t = t;
+  args.constantColor = { 1, 1, 1 };
+  bool textured = t && t->xsize * t->ysize > 1;
+  if (t && !textured)
+    getTextureRGB(t, 0, 0, args.constantColor.x, args.constantColor.y, args.constantColor.z);
+
+  const vertex* v = tri.v;
+  bool isFlat = v[0].nx == v[1].nx && v[0].ny == v[1].ny && v[0].nz == v[1].nz &&
+                v[0].nx == v[2].nx && v[0].ny == v[2].ny && v[0].nz == v[2].nz;
+  bool hasSpecular = tri.kspec != 0;
+  int count = args.context.numLights;
+  Isa isa = activeIsa();
+  args.kernel = SpanDispatch::pick<SpanTest::Depth>(textured, hasSpecular, count, isFlat, isa);
+  args.resolveKernel = SpanDispatch::pick<SpanTest::Owner>(textured, hasSpecular, count, isFlat, isa);
+  args.visibleKernel = SpanDispatch::pick<SpanTest::None>(textured, hasSpecular, count, isFlat, isa);
+}
+
+// The part that depends on where the triangle lands on screen
+inline void setupSpanGeometry(SpanKernelArgs& args, triangle tri, Vector3 surfaceNormal) {
+  args.tri = tri;
+  const vertex* v = tri.v;
+  args.flatNormal = normalize(Vector3{ v[0].nx, v[0].ny, v[0].nz });
+  args.deltaZ = surfaceNormal.z != 0 ? surfaceNormal.x / surfaceNormal.z : 0;
+}
+
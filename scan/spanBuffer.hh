@@ -0,0 +1,156 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+#include "util/vector3.hh"
+
+// One triangle's span on a row as the edges produced it, with what the
+// span kernels need to shade any piece of it
+struct SpanRecord {
+  unsigned id;	// the triangle's number in the scene
+  int startX, endX;
+  float startZ, deltaZ;	// depth steps by -deltaZ per pixel, as in drawSpan
+  Vector3 startUV, endUV, startN, endN;
+
+  float depth(int x) const { return startZ - deltaZ * (x - startX); }
+};
+
+// Hidden surface removal by spans (an S-buffer). Every row keeps the
+// visible pieces of the spans inserted so far, sorted by x, starting out
+// as one background piece at the far plane. A new span is compared with
+// each piece it overlaps only at the ends of the overlap, and split where
+// the two depth lines cross, so no depth is stored or tested per pixel.
+// Equal depths go to the span inserted first, like the depth buffer.
+class SpanBuffer {
+public:
+  SpanBuffer(int width, int height, float farthest)
+    : width(width), farthest(farthest), rows(height) {
+    clear();
+  }
+
+  void clear() {
+    for (auto& row : rows)
+      row.assign(1, { 0, width, background });
+    spans.clear();
+    spanPixels = 0;
+  }
+
+  void insert(int y, const SpanRecord& span) {
+    int a = std::max(0, span.startX), b = std::min(width, span.endX);
+    if (y < 0 || y >= (int)rows.size() || a >= b)
+      return;
+    int id = spans.size();
+    spans.push_back(span);
+    spanPixels += b - a;
+
+    std::vector<Piece>& row = rows[y];
+    auto first = std::upper_bound(row.begin(), row.end(), a,
+                                  [](int x, const Piece& piece) { return x < piece.x1; });
+    auto last = first;
+    pieces.clear();
+    for (; last != row.end() && last->x0 < b; ++last) {
+      const Piece& piece = *last;
+      int l = std::max(piece.x0, a), r = std::min(piece.x1, b);
+      add(piece.x0, l, piece.span);
+      resolve(l, r, id, piece.span);
+      add(r, piece.x1, piece.span);
+    }
+    auto at = row.erase(first, last);
+    row.insert(at, pieces.begin(), pieces.end());
+  }
+
+  // calls shade(span, y, x0, x1) for every visible piece, row by row
+  template <typename Shade>
+  void forEachVisible(Shade shade) const {
+    for (std::size_t y = 0; y < rows.size(); ++y) {
+      for (const Piece& piece : rows[y]) {
+        if (piece.span != background)
+          shade(spans[piece.span], (int)y, piece.x0, piece.x1);
+      }
+    }
+  }
+
+  // spans inserted, and their pixels, since the last clear
+  std::size_t getSpans() const { return spans.size(); }
+  std::size_t getSpanPixels() const { return spanPixels; }
+
+  // visible pieces and the pixels they cover
+  std::size_t countPieces(std::size_t& pixels) const {
+    std::size_t count = 0;
+    pixels = 0;
+    forEachVisible([&](const SpanRecord&, int, int x0, int x1) {
+      ++count;
+      pixels += x1 - x0;
+    });
+    return count;
+  }
+
+private:
+  static const int background = -1;
+
+  struct Piece {
+    int x0, x1;
+    int span;	// index into spans, or background
+  };
+
+  int width;
+  float farthest;
+  std::vector<std::vector<Piece>> rows;
+  std::vector<SpanRecord> spans;
+  std::size_t spanPixels;
+  std::vector<Piece> pieces;	// replacing the ones a new span overlaps
+
+  float depth(int span, int x) const {
+    return span == background ? farthest : spans[span].depth(x);
+  }
+
+  bool nearer(int span, int than, int x) const {
+    return depth(span, x) < depth(than, x);
+  }
+
+  // appends [x0, x1) of span, merged with the piece before when it is the
+  // same span
+  void add(int x0, int x1, int span) {
+    if (x0 >= x1)
+      return;
+    if (!pieces.empty() && pieces.back().span == span && pieces.back().x1 == x0)
+      pieces.back().x1 = x1;
+    else
+      pieces.push_back({ x0, x1, span });
+  }
+
+  // splits [l, r), held by old, between it and span where span is nearer
+  void resolve(int l, int r, int span, int old) {
+    if (l >= r)
+      return;
+    bool left = nearer(span, old, l);
+    bool right = nearer(span, old, r - 1);
+    if (left == right) {
+      add(l, r, left ? span : old);
+      return;
+    }
+    // the lines cross once: solve for the crossing, then settle the pixel
+    // it rounds to against the depths themselves
+    float dl = depth(span, l) - depth(old, l);
+    float dr = depth(span, r - 1) - depth(old, r - 1);
+    int cross = l + (int)std::ceil(dl / (dl - dr) * (r - 1 - l));
+    cross = std::min(std::max(cross, l + 1), r - 1);
+    while (cross > l + 1 && nearer(span, old, cross - 1) == right)
+      --cross;
+    while (cross < r - 1 && nearer(span, old, cross) != right)
+      ++cross;
+    add(l, cross, left ? span : old);
+    add(cross, r, right ? span : old);
+  }
+};
@@ -8,6 +8,10 @@
 
 #pragma once
 
+#include <cstddef>
+
+#include "util/vector3.hh"
+
 struct vertex {
   float x,y,z;		// x, y, z coordinates
   float nx,ny,nz;		// Normal at the vertex
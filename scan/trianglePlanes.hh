@@ -0,0 +1,69 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include "triangle.hh"
+#include "util/vector3.hh"
+
+// Screen space plane equations of the attributes interpolated across a
+// triangle, so they can be evaluated at any point instead of stepped
+// along edges and spans
+struct TrianglePlanes {
+  float x0, y0;	// where the planes are anchored, the first vertex
+  float z, dzdx, dzdy;
+  Vector3 n, dndx, dndy;
+  Vector3 uv, duvdx, duvdy;
+  bool valid;	// false when the triangle has no area on screen
+
+  float zAt(float x, float y) const {
+    return z + dzdx * (x - x0) + dzdy * (y - y0);
+  }
+  Vector3 normalAt(float x, float y) const {
+    return n + dndx * (x - x0) + dndy * (y - y0);
+  }
+  Vector3 uvAt(float x, float y) const {
+    return uv + duvdx * (x - x0) + duvdy * (y - y0);
+  }
+};
+
+inline TrianglePlanes makeTrianglePlanes(triangle tri) {
+  const vertex& a = tri.v[0];
+  const vertex& b = tri.v[1];
+  const vertex& c = tri.v[2];
+  TrianglePlanes planes;
+  planes.x0 = a.x;
+  planes.y0 = a.y;
+  planes.z = a.z;
+  planes.n = { a.nx, a.ny, a.nz };
+  planes.uv = { a.u, a.v, 0 };
+
+  float bx = b.x - a.x, by = b.y - a.y;
+  float cx = c.x - a.x, cy = c.y - a.y;
+  float area = bx * cy - cx * by;
+  planes.valid = area != 0;
+  if (!planes.valid) {
+    planes.dzdx = planes.dzdy = 0;
+    planes.dndx = planes.dndy = planes.duvdx = planes.duvdy = { 0, 0, 0 };
+    return planes;
+  }
+
+  // gradient of an attribute from its change along the two edges from a
+  auto gradient = [&](float db, float dc, float& ddx, float& ddy) {
+    ddx = (db * cy - dc * by) / area;
+    ddy = (dc * bx - db * cx) / area;
+  };
+  gradient(b.z - a.z, c.z - a.z, planes.dzdx, planes.dzdy);
+  gradient(b.nx - a.nx, c.nx - a.nx, planes.dndx.x, planes.dndy.x);
+  gradient(b.ny - a.ny, c.ny - a.ny, planes.dndx.y, planes.dndy.y);
+  gradient(b.nz - a.nz, c.nz - a.nz, planes.dndx.z, planes.dndy.z);
+  gradient(b.u - a.u, c.u - a.u, planes.duvdx.x, planes.duvdy.x);
+  gradient(b.v - a.v, c.v - a.v, planes.duvdx.y, planes.duvdy.y);
+  planes.duvdx.z = planes.duvdy.z = 0;
+  return planes;
+}
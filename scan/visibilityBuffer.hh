@@ -0,0 +1,62 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+
+// Nearest triangle of every pixel, for rendering triangles in parallel.
+// Each pixel packs (depth, triangle id) into 64 bits, depth in the high
+// half, so the nearest triangle is the smallest value and equal depths
+// go to the lower id, the triangle drawn first serially. Threads lower it
+// with compare-and-swap; shading is deferred until every triangle is in.
+class VisibilityBuffer {
+public:
+  static const std::uint32_t none = 0xffffffff;
+
+  VisibilityBuffer(int width, int height)
+    : width(width), pixels(new std::atomic<std::uint64_t>[width * height]), count(width * height) {
+    clear();
+  }
+
+  void clear() {
+    for (int i = 0; i < count; ++i)
+      pixels[i].store(~std::uint64_t(0), std::memory_order_relaxed);
+  }
+
+  // keeps triangle id at x, y if z is nearer than what is there
+  void test(int x, int y, float z, std::uint32_t id) {
+    std::uint64_t packed = (std::uint64_t)depthKey(z) << 32 | id;
+    std::atomic<std::uint64_t>& pixel = pixels[y * width + x];
+    std::uint64_t current = pixel.load(std::memory_order_relaxed);
+    while (packed < current &&
+           !pixel.compare_exchange_weak(current, packed, std::memory_order_relaxed))
+      ;
+  }
+
+  std::uint32_t owner(int x, int y) const {
+    return (std::uint32_t)pixels[y * width + x].load(std::memory_order_relaxed);
+  }
+
+private:
+  int width;
+  std::unique_ptr<std::atomic<std::uint64_t>[]> pixels;
+  int count;
+
+  // orders like the floats: flip negatives entirely, set the sign of
+  // positives
+  static std::uint32_t depthKey(float z) {
+    z += 0.0f;	// -0 sorts as 0
+    std::uint32_t bits;
+    std::memcpy(&bits, &z, sizeof bits);
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+  }
+};
@@ -0,0 +1,179 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+
+#include "instances.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+void grow(Box& box, Vector3 point) {
+  box.lower = { std::min(box.lower.x, point.x), std::min(box.lower.y, point.y),
+                std::min(box.lower.z, point.z) };
+  box.upper = { std::max(box.upper.x, point.x), std::max(box.upper.y, point.y),
+                std::max(box.upper.z, point.z) };
+}
+
+Box emptyBox() {
+  float big = std::numeric_limits<float>::max();
+  return { { big, big, big }, { -big, -big, -big } };
+}
+
+Vector3 corner(const Box& box, int i) {
+  return { i & 1 ? box.upper.x : box.lower.x, i & 2 ? box.upper.y : box.lower.y,
+           i & 4 ? box.upper.z : box.lower.z };
+}
+
+// x, y, z and w of matrix times (point, 1)
+void transform(const Matrix4& matrix, Vector3 point, float* out, int rows) {
+  for (int r = 0; r < rows; ++r) {
+    const float* m = matrix.m[r];
+    out[r] = m[0] * point.x + m[1] * point.y + m[2] * point.z + m[3];
+  }
+}
+
+}
+
+Box triangleBounds(const std::vector<triangle>& triangles) {
+  Box box = emptyBox();
+  for (const auto& tri : triangles) {
+    for (const auto& v : tri.v)
+      grow(box, { v.x, v.y, v.z });
+  }
+  return box;
+}
+
+Matrix4 instanceMatrix(const Instance& instance) {
+  return translation(instance.position) * rotationY(instance.yaw) *
+         scaling({ instance.scale, instance.scale, instance.scale });
+}
+
+Box instanceBounds(const Mesh& mesh, const Instance& instance) {
+  if (mesh.triangles.empty())
+    return emptyBox();
+  Matrix4 matrix = instanceMatrix(instance);
+  Box box = emptyBox();
+  for (int i = 0; i < 8; ++i) {
+    float p[3];
+    transform(matrix, corner(mesh.bounds, i), p, 3);
+    grow(box, { p[0], p[1], p[2] });
+  }
+  return box;
+}
+
+Vector3 sceneCenter(const Scene& scene) {
+  Box box = triangleBounds(scene.triangles);
+  for (const auto& instance : scene.instances) {
+    Box placed = instanceBounds(scene.meshes[instance.mesh], instance);
+    if (placed.lower.x <= placed.upper.x) {
+      grow(box, placed.lower);
+      grow(box, placed.upper);
+    }
+  }
+  if (box.lower.x > box.upper.x)
+    return { 0, 0, 0 };
+  return (box.lower + box.upper) / 2;
+}
+
+void placeInstance(const Mesh& mesh, const Instance& instance, triangle* out) {
+  Matrix4 matrix = instanceMatrix(instance);
+  // a uniform scale leaves directions alone, so normals only turn
+  Matrix4 turn = rotationY(instance.yaw);
+  for (const auto& tri : mesh.triangles) {
+    *out = tri;
+    for (auto& v : out->v) {
+      float p[3], n[3];
+      transform(matrix, { v.x, v.y, v.z }, p, 3);
+      transform(turn, { v.nx, v.ny, v.nz }, n, 3);
+      v.x = p[0], v.y = p[1], v.z = p[2];
+      v.nx = n[0], v.ny = n[1], v.nz = n[2];
+    }
+    if (instance.overrides & OverrideTexture)
+      out->whichtexture = instance.whichtexture;
+    if (instance.overrides & OverrideAmbient)
+      out->kamb = instance.kamb;
+    if (instance.overrides & OverrideDiffuse)
+      out->kdiff = instance.kdiff;
+    if (instance.overrides & OverrideSpecular)
+      out->kspec = instance.kspec;
+    if (instance.overrides & OverrideShininess)
+      out->shininess = instance.shininess;
+    ++out;
+  }
+}
+
+bool boxOnScreen(const Box& box, int width, int height) {
+  return box.lower.x < width && box.upper.x >= 0 && box.lower.y < height && box.upper.y >= 0;
+}
+
+bool boxInFrustum(const Box& box, const Matrix4& clipFromScene) {
+  // bits of the planes each corner is outside of, -w <= x, y, z <= w inside
+  unsigned outside = 63;
+  for (int i = 0; i < 8; ++i) {
+    float c[4];
+    transform(clipFromScene, corner(box, i), c, 4);
+    unsigned planes = 0;
+    for (int axis = 0; axis < 3; ++axis) {
+      if (c[axis] < -c[3])
+        planes |= 1 << (2 * axis);
+      if (c[axis] > c[3])
+        planes |= 2 << (2 * axis);
+    }
+    outside &= planes;
+  }
+  return outside == 0;
+}
+
+std::size_t appendInstances(const Scene& scene, const std::function<bool(const Box&)>& visible,
+                            std::vector<triangle>& out) {
+  std::size_t count = 0;
+  for (const auto& instance : scene.instances) {
+    const Mesh& mesh = scene.meshes[instance.mesh];
+    if (mesh.triangles.empty() || !visible(instanceBounds(mesh, instance)))
+      continue;
+    std::size_t first = out.size();
+    out.resize(first + mesh.triangles.size());
+    placeInstance(mesh, instance, &out[first]);
+    ++count;
+  }
+  return count;
+}
+
+void placeOnScreen(const Mesh& mesh, const Instance& instance, const Box& bounds,
+                   Viewport viewport, std::vector<triangle>& out) {
+  bool inside = bounds.lower.x >= 0 && bounds.upper.x <= viewport.width - 1 &&
+                bounds.lower.y >= 0 && bounds.upper.y <= viewport.height - 1;
+  if (inside) {
+    std::size_t first = out.size();
+    out.resize(first + mesh.triangles.size());
+    placeInstance(mesh, instance, &out[first]);
+    return;
+  }
+  std::vector<triangle> placed(mesh.triangles.size());
+  placeInstance(mesh, instance, placed.data());
+  for (const auto& tri : placed)
+    clipToViewport(tri, viewport, out);
+}
+
+std::size_t appendOnScreen(const Scene& scene, Viewport viewport, std::vector<triangle>& out) {
+  std::size_t count = 0;
+  for (const auto& instance : scene.instances) {
+    const Mesh& mesh = scene.meshes[instance.mesh];
+    if (mesh.triangles.empty())
+      continue;
+    Box bounds = instanceBounds(mesh, instance);
+    if (!boxOnScreen(bounds, viewport.width, viewport.height))
+      continue;
+    placeOnScreen(mesh, instance, bounds, viewport, out);
+    ++count;
+  }
+  return count;
+}
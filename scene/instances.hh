@@ -0,0 +1,56 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+#include "scene/scene.hh"
+#include "scene/vertexTransform.hh"
+#include "util/matrix4.hh"
+
+// bounding box of the triangles
+Box triangleBounds(const std::vector<triangle>& triangles);
+
+// Places the mesh of instance in the scene
+Matrix4 instanceMatrix(const Instance& instance);
+
+// box around the instance's mesh as placed in the scene
+Box instanceBounds(const Mesh& mesh, const Instance& instance);
+
+// center of the box around the triangles and every instance
+Vector3 sceneCenter(const Scene& scene);
+
+// Writes the triangles of mesh as placed by instance to out, one per mesh
+// triangle, with the material fields the instance overrides
+void placeInstance(const Mesh& mesh, const Instance& instance, triangle* out);
+
+// whether any of box is on a screen of width by height pixels
+bool boxOnScreen(const Box& box, int width, int height);
+
+// Whether the box may be seen through clipFromScene, false only when all
+// its corners are outside the same clip plane
+bool boxInFrustum(const Box& box, const Matrix4& clipFromScene);
+
+// Appends the triangles of every instance whose box is visible to out,
+// returns how many instances that were
+std::size_t appendInstances(const Scene& scene, const std::function<bool(const Box&)>& visible,
+                            std::vector<triangle>& out);
+
+// Appends the triangles of a screen space instance whose box is bounds to
+// out, clipped to the viewport when the box is partly off it, as the scan
+// converter does not clip
+void placeOnScreen(const Mesh& mesh, const Instance& instance, const Box& bounds,
+                   Viewport viewport, std::vector<triangle>& out);
+
+// Appends the triangles of every instance on screen to out, clipped to
+// it, returns how many instances that were
+std::size_t appendOnScreen(const Scene& scene, Viewport viewport, std::vector<triangle>& out);
@@ -0,0 +1,82 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <string>
+#include <vector>
+
+#include "scan/triangle.hh"
+#include "texture/texture.hh"
+#include "util/vector3.hh"
+
+struct color {
+  float r, g, b;
+};
+
+struct light {
+  // Note: assume all lights are white
+  float x,y,z;		// x, y, z coordinates of light
+  color brightness;	// Level of brightness of light (0.0 - 1.0)
+};
+
+// Axis aligned box, lower corner to upper
+struct Box {
+  Vector3 lower, upper;
+};
+
+// Triangles defined once, placed in the scene by any number of instances
+struct Mesh {
+  std::string name;
+  std::vector<triangle> triangles;
+  Box bounds;
+};
+
+// Material fields an instance sets for all triangles of its mesh
+enum InstanceOverride : unsigned {
+  OverrideTexture = 1,
+  OverrideAmbient = 2,
+  OverrideDiffuse = 4,
+  OverrideSpecular = 8,
+  OverrideShininess = 16
+};
+
+// A mesh scaled, turned yaw degrees about the y axis and then moved to
+// position
+struct Instance {
+  std::size_t mesh;
+  Vector3 position;
+  float yaw, scale;
+  unsigned overrides;	// InstanceOverride bits of the fields below in use
+  int whichtexture;
+  float kamb, kdiff, kspec;
+  int shininess;
+};
+
+// Everything read from a scene file
+struct Scene {
+  std::vector<triangle> triangles;
+  std::vector<Mesh> meshes;
+  std::vector<Instance> instances;
+  std::vector<light> lights;
+  color ambient;		// The coefficient of ambient light
+  std::vector<texture> textures;
+  // identifies what each texture entry of the file holds, so a reload can
+  // tell which textures it may keep
+  std::vector<std::uint64_t> textureKeys;
+
+  // Textures may still be loading when the geometry is ready, one entry
+  // per texture that becomes true once it loaded or false if it failed
+  std::vector<std::shared_future<bool>> texturesLoaded;
+
+  // block until texture i has loaded, returns false if it could not be read
+  bool waitForTexture(int i) const { return texturesLoaded[i].get(); }
+};
@@ -0,0 +1,103 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "sceneDiff.hh"
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+bool sameTriangle(const triangle& a, const triangle& b) {
+  return std::memcmp(&a, &b, sizeof(triangle)) == 0;
+}
+
+bool sameLight(const light& a, const light& b) {
+  return a.x == b.x && a.y == b.y && a.z == b.z && a.brightness.r == b.brightness.r &&
+         a.brightness.g == b.brightness.g && a.brightness.b == b.brightness.b;
+}
+
+bool sameLighting(const Scene& before, const Scene& after) {
+  if (before.ambient.r != after.ambient.r || before.ambient.g != after.ambient.g ||
+      before.ambient.b != after.ambient.b || before.lights.size() != after.lights.size())
+    return false;
+  for (std::size_t i = 0; i < before.lights.size(); ++i) {
+    if (!sameLight(before.lights[i], after.lights[i]))
+      return false;
+  }
+  return true;
+}
+
+}
+
+Region triangleRegion(const triangle& tri, int width, int height) {
+  const vertex* v = tri.v;
+  // a pixel of slack for rounding at the edges
+  Region region;
+  region.x0 = std::max(0, (int)std::floor(std::min({ v[0].x, v[1].x, v[2].x })) - 1);
+  region.y0 = std::max(0, (int)std::floor(std::min({ v[0].y, v[1].y, v[2].y })) - 1);
+  region.x1 = std::min(width, (int)std::ceil(std::max({ v[0].x, v[1].x, v[2].x })) + 2);
+  region.y1 = std::min(height, (int)std::ceil(std::max({ v[0].y, v[1].y, v[2].y })) + 2);
+  return region;
+}
+
+SceneDiff diffScenes(const Scene& before, const Scene& after, int width, int height,
+                     int tileSize) {
+  SceneDiff diff;
+  diff.lighting = !sameLighting(before, after);
+
+  std::vector<bool> changedTexture(after.textureKeys.size());
+  for (std::size_t i = 0; i < changedTexture.size(); ++i) {
+    changedTexture[i] = i >= before.textureKeys.size() ||
+                        before.textureKeys[i] != after.textureKeys[i];
+    if (std::count(before.textureKeys.begin(), before.textureKeys.end(), after.textureKeys[i]))
+      ++diff.keptTextures;
+  }
+  auto textureChanged = [&](const triangle& tri) {
+    return tri.whichtexture >= 0 && (std::size_t)tri.whichtexture < changedTexture.size() &&
+           changedTexture[tri.whichtexture];
+  };
+
+  const std::vector<triangle>& old = before.triangles;
+  const std::vector<triangle>& now = after.triangles;
+  std::size_t prefix = 0;
+  while (prefix < old.size() && prefix < now.size() && sameTriangle(old[prefix], now[prefix]))
+    ++prefix;
+  std::size_t suffix = 0;
+  while (suffix < old.size() - prefix && suffix < now.size() - prefix &&
+         sameTriangle(old[old.size() - 1 - suffix], now[now.size() - 1 - suffix]))
+    ++suffix;
+
+  for (std::size_t i = prefix; i < old.size() - suffix; ++i)
+    diff.region.add(triangleRegion(old[i], width, height));
+  for (std::size_t i = 0; i < now.size(); ++i) {
+    bool kept = i < prefix || i >= now.size() - suffix;
+    if (kept && !textureChanged(now[i]))
+      continue;
+    ++diff.changedTriangles;
+    diff.region.add(triangleRegion(now[i], width, height));
+  }
+
+  // instances are not matched, any of them redraws everything
+  if (!before.instances.empty() || !after.instances.empty()) {
+    Region screen;
+    screen.x1 = width;
+    screen.y1 = height;
+    diff.region = screen;
+  }
+
+  if (!diff.region.empty()) {
+    Region& r = diff.region;
+    r.x0 = r.x0 / tileSize * tileSize;
+    r.y0 = r.y0 / tileSize * tileSize;
+    r.x1 = std::min(width, (r.x1 + tileSize - 1) / tileSize * tileSize);
+    r.y1 = std::min(height, (r.y1 + tileSize - 1) / tileSize * tileSize);
+  }
+  return diff;
+}
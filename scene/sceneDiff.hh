@@ -0,0 +1,58 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+#include "scene/scene.hh"
+
+// Pixels [x0, x1) x [y0, y1) of the screen
+struct Region {
+  int x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+
+  bool empty() const { return x0 >= x1 || y0 >= y1; }
+  int area() const { return empty() ? 0 : (x1 - x0) * (y1 - y0); }
+
+  void add(const Region& other) {
+    if (other.empty())
+      return;
+    if (empty()) {
+      *this = other;
+      return;
+    }
+    x0 = std::min(x0, other.x0);
+    y0 = std::min(y0, other.y0);
+    x1 = std::max(x1, other.x1);
+    y1 = std::max(y1, other.y1);
+  }
+
+  bool overlaps(const Region& other) const {
+    return x0 < other.x1 && other.x0 < x1 && y0 < other.y1 && other.y0 < y1;
+  }
+};
+
+// pixels a screen space triangle may touch, clamped to the screen
+Region triangleRegion(const triangle& tri, int width, int height);
+
+// What changed between two loads of a scene file
+struct SceneDiff {
+  bool lighting = false;	// lights or ambient changed, which touches every pixel
+  Region region;	// covers every changed triangle, where it was and where it is
+  std::size_t changedTriangles = 0;
+  std::size_t keptTextures = 0;
+};
+
+// Triangles are matched by the longest common prefix and suffix of the
+// two lists, so edits, insertions and deletions anywhere keep the order of
+// everything around them. A triangle also counts as changed when its
+// texture did. The region is grown to whole tiles of tileSize pixels, and
+// is the whole screen when either scene has instances.
+SceneDiff diffScenes(const Scene& before, const Scene& after, int width, int height,
+                     int tileSize);
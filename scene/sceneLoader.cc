@@ -0,0 +1,437 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "sceneLoader.hh"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <utility>
+
+#include "instances.hh"
+#include "trace/trace.hh"
+#include "util/tokenReader.hh"
+
+namespace {
+
+const std::size_t tokensPerTriangle = 5 + 3 * 8;
+const std::size_t tokensPerLight = 6;
+const std::size_t tokensPerInstance = 11;
+// enough work per job to amortize scheduling
+const std::size_t trianglesPerJob = 4096;
+const std::size_t instancesPerJob = 4096;
+
+// the part of the file a job reads
+struct Block {
+  const char* begin;
+  const char* end;
+};
+
+// Steps over count records of tokens each, split in blocks of perJob.
+// in fails if the file ends first.
+void findRecords(TokenReader& in, std::size_t count, std::size_t tokens, std::size_t perJob,
+                 std::vector<Block>& blocks) {
+  for (std::size_t first = 0; first < count; first += perJob) {
+    const char* begin = in.position;
+    in.skip(std::min(perJob, count - first) * tokens);
+    blocks.push_back({ begin, in.position });
+  }
+}
+
+// A mesh of the file, before its triangles are read
+struct MeshEntry {
+  std::string name;
+  std::size_t count;
+  std::vector<Block> blocks;
+};
+
+// whether the next word is the name of the section, which is then skipped
+bool section(TokenReader& in, const char* name) {
+  TokenReader peek = in;
+  if (peek.nextWord() != name)
+    return false;
+  in = peek;
+  return true;
+}
+
+// whether the next word is "-", keeping a field of the mesh
+bool keeps(TokenReader& in) {
+  TokenReader peek = in;
+  if (peek.nextWord() != "-")
+    return false;
+  in = peek;
+  return true;
+}
+
+// Reads triangle records, which are named as of mesh if it is not empty.
+// Returns an error, empty when there was none; tri is number first.
+std::string readTriangles(TokenReader in, triangle* tri, std::size_t count, std::size_t first,
+                          const std::string& mesh) {
+  TRACE_SCOPE("loadTriangles");
+  for (std::size_t i = 0; i < count; ++i, ++tri) {
+    tri->whichtexture = in.nextInt();
+    tri->kamb = in.nextFloat();
+    tri->kdiff = in.nextFloat();
+    tri->kspec = in.nextFloat();
+    tri->shininess = in.nextInt();
+    for (int j = 0; j < 3; ++j) {
+      vertex& v = tri->v[j];
+      v.x = in.nextFloat(); v.y = in.nextFloat(); v.z = in.nextFloat();
+      v.nx = in.nextFloat(); v.ny = in.nextFloat(); v.nz = in.nextFloat();
+      v.u = in.nextFloat(); v.v = in.nextFloat();
+    }
+    if (in.fail)
+      return "Malformed triangle " + std::to_string(first + i) +
+             (mesh.empty() ? "" : " of mesh " + mesh);
+  }
+  return "";
+}
+
+// Reads instance records, named meshes looked up in meshes. Returns an
+// error, empty when there was none; instance is the index of the first.
+std::string readInstances(TokenReader in, Instance* instance, std::size_t count,
+                          std::size_t first,
+                          const std::unordered_map<std::string, std::size_t>& meshes) {
+  TRACE_SCOPE("loadInstances");
+  for (std::size_t i = 0; i < count; ++i, ++instance) {
+    std::string index = std::to_string(first + i);
+    auto mesh = meshes.find(in.nextWord());
+    if (mesh == meshes.end())
+      return "Instance " + index + " names an unknown mesh";
+    instance->mesh = mesh->second;
+    instance->position.x = in.nextFloat();
+    instance->position.y = in.nextFloat();
+    instance->position.z = in.nextFloat();
+    instance->yaw = in.nextFloat();
+    instance->scale = in.nextFloat();
+    instance->overrides = 0;
+    if (!keeps(in)) {
+      instance->whichtexture = in.nextInt();
+      instance->overrides |= OverrideTexture;
+    }
+    if (!keeps(in)) {
+      instance->kamb = in.nextFloat();
+      instance->overrides |= OverrideAmbient;
+    }
+    if (!keeps(in)) {
+      instance->kdiff = in.nextFloat();
+      instance->overrides |= OverrideDiffuse;
+    }
+    if (!keeps(in)) {
+      instance->kspec = in.nextFloat();
+      instance->overrides |= OverrideSpecular;
+    }
+    if (!keeps(in)) {
+      instance->shininess = in.nextInt();
+      instance->overrides |= OverrideShininess;
+    }
+    if (in.fail)
+      return "Malformed instance " + index;
+    if (!(instance->scale > 0))
+      return "Instance " + index + " needs a scale above 0";
+  }
+  return "";
+}
+
+// returns an error, empty when there was none
+std::string readLights(TokenReader in, Scene& scene) {
+  TRACE_SCOPE("loadLights");
+  scene.ambient.r = in.nextFloat();
+  scene.ambient.g = in.nextFloat();
+  scene.ambient.b = in.nextFloat();
+  for (auto& l : scene.lights) {
+    l.x = in.nextFloat(); l.y = in.nextFloat(); l.z = in.nextFloat();
+    l.brightness.r = in.nextFloat();
+    l.brightness.g = in.nextFloat();
+    l.brightness.b = in.nextFloat();
+  }
+  return in.fail ? "Malformed ambient light or lights" : "";
+}
+
+// step over one texture entry, which is inline or the name of a file
+bool skipTexture(TokenReader& in) {
+  TokenReader peek = in;
+  std::string first = peek.nextWord();
+  if (in.fail || first.empty())
+    return false;
+  if (!inlineTexture(first)) {
+    in = peek;
+    return true;
+  }
+  int xsize = in.nextInt();
+  int ysize = in.nextInt();
+  if (in.fail || xsize <= 0 || ysize <= 0)
+    return false;
+  in.skip((std::size_t)xsize * ysize * 3);
+  return !in.fail;
+}
+
+// FNV-1a over a texture entry, plus the size and time of the texture
+// file it names
+std::uint64_t textureKey(Block block, const std::string& directory) {
+  std::uint64_t hash = 0xcbf29ce484222325ull;
+  auto mix = [&hash](const char* begin, const char* end) {
+    for (const char* c = begin; c != end; ++c)
+      hash = (hash ^ (unsigned char)*c) * 0x100000001b3ull;
+  };
+  // from the first token on, the space before it belongs to the layout of
+  // whatever precedes the entry
+  while (block.begin != block.end && std::isspace((unsigned char)*block.begin))
+    ++block.begin;
+  mix(block.begin, block.end);
+  TokenReader in(block.begin, block.end);
+  std::string first = in.nextWord();
+  struct stat status;
+  if (!first.empty() && !inlineTexture(first)) {
+    std::string path = first[0] == '/' || directory.empty() ? first : directory + "/" + first;
+    if (stat(path.c_str(), &status) == 0) {
+      std::int64_t stamp[3] = { (std::int64_t)status.st_size, (std::int64_t)status.st_mtim.tv_sec,
+                                (std::int64_t)status.st_mtim.tv_nsec };
+      mix((const char*)stamp, (const char*)(stamp + 3));
+    }
+  }
+  return hash;
+}
+
+}
+
+bool loadScene(const std::string& path, Scene& scene, ThreadPool& pool,
+               TextureFormat textureFormat, std::string& error, Scene* previous) {
+  TRACE_SCOPE("loadScene");
+  auto contents = std::make_shared<std::string>();
+  {
+    TRACE_SCOPE("readFile");
+    std::ifstream infile(path, std::ios::binary);
+    if (!infile) {
+      error = "Input file " + path + " does not exist!";
+      return false;
+    }
+    std::ostringstream buffer;
+    buffer << infile.rdbuf();
+    *contents = buffer.str();
+  }
+
+  // find where every block starts without converting any numbers, so the
+  // blocks can then be read in parallel
+  TokenReader in(contents->data(), contents->data() + contents->size());
+  int numtriangles = in.nextInt();
+  int numlights = in.nextInt();
+  int numtextures = in.nextInt();
+  if (in.fail || numtriangles < 0 || numlights < 0 || numtextures < 0) {
+    error = "Malformed header in " + path;
+    return false;
+  }
+
+  std::vector<Block> triangleBlocks;
+  Block lightBlock;
+  std::vector<Block> textureBlocks(numtextures);
+  {
+    TRACE_SCOPE("findBlocks");
+    findRecords(in, numtriangles, tokensPerTriangle, trianglesPerJob, triangleBlocks);
+    lightBlock.begin = in.position;
+    in.skip(3 + numlights * tokensPerLight);
+    lightBlock.end = in.position;
+    if (in.fail) {
+      error = "Not enough triangles or lights in " + path;
+      return false;
+    }
+    for (int i = 0; i < numtextures; ++i) {
+      textureBlocks[i].begin = in.position;
+      if (!skipTexture(in)) {
+        error = "Could not read texture " + std::to_string(i) + " of " + path;
+        return false;
+      }
+      textureBlocks[i].end = in.position;
+    }
+  }
+
+  // meshes and then instances may follow the textures, each section
+  // starting with its name and count
+  std::vector<MeshEntry> meshEntries;
+  std::unordered_map<std::string, std::size_t> meshIndex;
+  std::vector<Block> instanceBlocks;
+  std::size_t numinstances = 0;
+  {
+    TRACE_SCOPE("findInstancing");
+    if (section(in, "meshes")) {
+      int nummeshes = in.nextInt();
+      if (in.fail || nummeshes < 0) {
+        error = "Malformed meshes section in " + path;
+        return false;
+      }
+      meshEntries.resize(nummeshes);
+      for (std::size_t i = 0; i < meshEntries.size(); ++i) {
+        MeshEntry& mesh = meshEntries[i];
+        mesh.name = in.nextWord();
+        int count = in.nextInt();
+        if (in.fail || count < 0) {
+          error = "Malformed mesh " + std::to_string(i) + " in " + path;
+          return false;
+        }
+        if (!meshIndex.emplace(mesh.name, i).second) {
+          error = "Mesh " + mesh.name + " is defined twice in " + path;
+          return false;
+        }
+        mesh.count = count;
+        findRecords(in, mesh.count, tokensPerTriangle, trianglesPerJob, mesh.blocks);
+        if (in.fail) {
+          error = "Not enough triangles in mesh " + mesh.name + " of " + path;
+          return false;
+        }
+      }
+    }
+    if (section(in, "instances")) {
+      int count = in.nextInt();
+      if (in.fail || count < 0) {
+        error = "Malformed instances section in " + path;
+        return false;
+      }
+      numinstances = count;
+      // "-" fields are single tokens too, so records are a fixed length
+      findRecords(in, numinstances, tokensPerInstance, instancesPerJob, instanceBlocks);
+      if (in.fail) {
+        error = "Not enough instances in " + path;
+        return false;
+      }
+    }
+  }
+
+  std::size_t slash = path.find_last_of('/');
+  std::string directory = slash == std::string::npos ? "" : path.substr(0, slash);
+  std::vector<std::uint64_t> keys(numtextures);
+  {
+    TRACE_SCOPE("textureKeys");
+    for (int i = 0; i < numtextures; ++i)
+      keys[i] = textureKey(textureBlocks[i], directory);
+  }
+
+  scene.triangles.resize(numtriangles);
+  scene.meshes.clear();
+  scene.meshes.resize(meshEntries.size());
+  for (std::size_t i = 0; i < meshEntries.size(); ++i) {
+    scene.meshes[i].name = meshEntries[i].name;
+    scene.meshes[i].triangles.resize(meshEntries[i].count);
+  }
+  scene.instances.resize(numinstances);
+  scene.lights.resize(numlights);
+  scene.textures.clear();
+  scene.textures.resize(numtextures);
+  scene.textureKeys = keys;
+  scene.texturesLoaded.clear();
+
+  // instances are read first, as an unknown mesh fails the load and
+  // nothing may be taken from previous by then
+  {
+    TRACE_SCOPE("readInstances");
+    std::vector<std::future<std::string>> instancing;
+    const auto* names = &meshIndex;
+    for (std::size_t i = 0; i < instanceBlocks.size(); ++i) {
+      std::size_t first = i * instancesPerJob;
+      Instance* instance = &scene.instances[first];
+      std::size_t count = std::min(instancesPerJob, numinstances - first);
+      Block block = instanceBlocks[i];
+      instancing.push_back(pool.submit([contents, block, instance, count, first, names]() {
+        return readInstances(TokenReader(block.begin, block.end), instance, count, first, *names);
+      }));
+    }
+    bool instancesRead = true;
+    for (auto& job : instancing) {
+      std::string message = job.get();
+      if (instancesRead && !message.empty()) {
+        error = message + " in " + path;
+        instancesRead = false;
+      }
+    }
+    if (!instancesRead)
+      return false;
+  }
+
+  // where each texture of previous is, by key
+  std::unordered_map<std::uint64_t, std::size_t> kept;
+  if (previous) {
+    for (std::size_t i = 0; i < previous->textureKeys.size(); ++i)
+      kept.emplace(previous->textureKeys[i], i);
+  }
+
+  // textures go first so they are not queued behind the geometry
+  std::vector<std::pair<std::size_t, std::size_t>> taken;	// from previous, (ours, theirs)
+  for (int i = 0; i < numtextures; ++i) {
+    texture* t = &scene.textures[i];
+    auto found = kept.find(keys[i]);
+    if (found != kept.end()) {
+      std::size_t j = found->second;
+      std::promise<bool> loaded;
+      loaded.set_value(previous->waitForTexture(j));
+      *t = std::move(previous->textures[j]);
+      taken.emplace_back(i, j);
+      scene.texturesLoaded.push_back(loaded.get_future().share());
+      // a texture listed twice is loaded again the second time
+      kept.erase(found);
+      continue;
+    }
+    Block block = textureBlocks[i];
+    scene.texturesLoaded.push_back(pool.submit([contents, block, directory, t, textureFormat]() {
+      TRACE_SCOPE("loadTexture");
+      TokenReader in(block.begin, block.end);
+      if (!readTexture(in, directory, *t))
+        return false;
+      // texture files keep the format they were compressed to
+      if (t->format == TextureFormat::Float)
+        convertTexture(*t, textureFormat);
+      return true;
+    }).share());
+  }
+
+  std::vector<std::future<std::string>> geometry;
+  auto submitTriangles = [&](const std::vector<Block>& blocks, std::vector<triangle>& triangles,
+                             const std::string& mesh) {
+    for (std::size_t i = 0; i < blocks.size(); ++i) {
+      std::size_t index = i * trianglesPerJob;
+      triangle* first = &triangles[index];
+      std::size_t count = std::min(trianglesPerJob, triangles.size() - index);
+      Block block = blocks[i];
+      geometry.push_back(pool.submit([contents, block, first, count, index, mesh]() {
+        return readTriangles(TokenReader(block.begin, block.end), first, count, index, mesh);
+      }));
+    }
+  };
+  submitTriangles(triangleBlocks, scene.triangles, "");
+  for (std::size_t i = 0; i < meshEntries.size(); ++i)
+    submitTriangles(meshEntries[i].blocks, scene.meshes[i].triangles, meshEntries[i].name);
+  Scene* target = &scene;
+  geometry.push_back(pool.submit([contents, lightBlock, target]() {
+    return readLights(TokenReader(lightBlock.begin, lightBlock.end), *target);
+  }));
+
+  TRACE_SCOPE("waitForGeometry");
+  std::string message;
+  for (auto& job : geometry) {
+    std::string result = job.get();
+    if (message.empty())
+      message = result;
+  }
+  if (!message.empty()) {
+    error = message + " in " + path;
+    // the texture jobs write into scene, and what was taken from previous
+    // goes back to it, as the caller may keep using previous
+    for (std::size_t i = 0; i < scene.texturesLoaded.size(); ++i)
+      scene.waitForTexture(i);
+    for (const auto& pair : taken)
+      previous->textures[pair.second] = std::move(scene.textures[pair.first]);
+    return false;
+  }
+  for (auto& mesh : scene.meshes)
+    mesh.bounds = triangleBounds(mesh.triangles);
+  return true;
+}
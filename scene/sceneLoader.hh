@@ -0,0 +1,28 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <string>
+
+#include "scene.hh"
+#include "texture/texture.hh"
+#include "util/threadPool.hh"
+
+// Loads a scene file as independent jobs on the pool: blocks of triangles,
+// of mesh triangles and of instances, the lights and every texture. Returns once the triangles and lights are
+// in place while textures keep loading, see Scene::waitForTexture.
+// Inline textures are converted to textureFormat as they load.
+// When reloading, textures whose entry is the same as in previous (and,
+// for texture files, whose file was not touched) are moved over from
+// previous instead of being loaded again.
+// returns false with a message in error if the file is malformed, with
+// previous left as it was
+bool loadScene(const std::string& path, Scene& scene, ThreadPool& pool,
+               TextureFormat textureFormat, std::string& error,
+               Scene* previous = nullptr);
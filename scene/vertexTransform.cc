@@ -0,0 +1,241 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "vertexTransform.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "trace/trace.hh"
+#include "util/vector4.hh"
+#include "util/vectorBatch.hh"
+
+namespace {
+
+// a vertex while it is clipped: clip or screen position, then attributes
+struct ClipVertex {
+  float x, y, z, w;
+  float nx, ny, nz, u, v;
+};
+
+const int clipFloats = 9;
+
+ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t) {
+  const float* from = &a.x;
+  const float* to = &b.x;
+  ClipVertex result;
+  float* out = &result.x;
+  for (int i = 0; i < clipFloats; ++i)
+    out[i] = from[i] + (to[i] - from[i]) * t;
+  return result;
+}
+
+// Sutherland-Hodgman against the half space distance(v) >= 0
+template <typename Distance>
+std::vector<ClipVertex> clip(const std::vector<ClipVertex>& polygon, Distance distance) {
+  std::vector<ClipVertex> result;
+  for (std::size_t i = 0; i < polygon.size(); ++i) {
+    const ClipVertex& a = polygon[i];
+    const ClipVertex& b = polygon[(i + 1) % polygon.size()];
+    float da = distance(a), db = distance(b);
+    if (da >= 0)
+      result.push_back(a);
+    if ((da >= 0) != (db >= 0))
+      result.push_back(lerp(a, b, da / (da - db)));
+  }
+  return result;
+}
+
+ClipVertex toScreen(ClipVertex v, Viewport viewport) {
+  v.x = (v.x / v.w + 1) / 2 * viewport.width;
+  v.y = (v.y / v.w + 1) / 2 * viewport.height;
+  v.z = (v.z / v.w + 1) / 2 * viewport.depth;
+  v.w = 1;
+  return v;
+}
+
+bool onScreen(const ClipVertex& v, Viewport viewport) {
+  return v.x >= 0 && v.x <= viewport.width - 1 && v.y >= 0 && v.y <= viewport.height - 1;
+}
+
+// the scan converter expects vertices on whole pixels, like the ones in
+// scene files
+vertex toVertex(const ClipVertex& v) {
+  Vector3 normal = normalize(Vector3{ v.nx, v.ny, v.nz });
+  return { std::round(v.x), std::round(v.y), v.z, normal.x, normal.y, normal.z, v.u, v.v };
+}
+
+// clips a polygon in screen space to the viewport and appends what is
+// left of it, fanned into triangles with the material of tri
+void clipToScreen(std::vector<ClipVertex> polygon, const triangle& tri, Viewport viewport,
+                  std::vector<triangle>& out) {
+  float right = viewport.width - 1, top = viewport.height - 1;
+  polygon = clip(polygon, [](const ClipVertex& v) { return v.x; });
+  polygon = clip(polygon, [=](const ClipVertex& v) { return right - v.x; });
+  polygon = clip(polygon, [](const ClipVertex& v) { return v.y; });
+  polygon = clip(polygon, [=](const ClipVertex& v) { return top - v.y; });
+  for (std::size_t i = 1; i + 1 < polygon.size(); ++i) {
+    triangle piece = tri;
+    piece.v[0] = toVertex(polygon[0]);
+    piece.v[1] = toVertex(polygon[i]);
+    piece.v[2] = toVertex(polygon[i + 1]);
+    out.push_back(piece);
+  }
+}
+
+// clips a triangle in clip space and appends what is left of it, fanned
+// into triangles
+void clipTriangle(const triangle& tri, const ClipVertex* corners, Viewport viewport,
+                  std::vector<triangle>& out) {
+  std::vector<ClipVertex> polygon(corners, corners + 3);
+  polygon = clip(polygon, [](const ClipVertex& v) { return v.z + v.w; });
+  for (auto& v : polygon)
+    v = toScreen(v, viewport);
+  clipToScreen(polygon, tri, viewport, out);
+}
+
+// rows of matrix applied to count points held structure-of-arrays
+void transformPoints(const Matrix4& matrix, const float* x, const float* y, const float* z,
+                     float* const* out, int rows, int count) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    Vector4 px = Vector4::load(x + i), py = Vector4::load(y + i), pz = Vector4::load(z + i);
+    for (int r = 0; r < rows; ++r) {
+      const float* m = matrix.m[r];
+      (px * m[0] + py * m[1] + pz * m[2] + Vector4::broadcast(m[3])).store(out[r] + i);
+    }
+  }
+  for (; i < count; ++i) {
+    for (int r = 0; r < rows; ++r) {
+      const float* m = matrix.m[r];
+      out[r][i] = x[i] * m[0] + y[i] * m[1] + z[i] * m[2] + m[3];
+    }
+  }
+}
+
+}
+
+Vector3 sceneCenter(const std::vector<triangle>& triangles) {
+  float big = std::numeric_limits<float>::max();
+  Vector3 low = { big, big, big }, high = { -big, -big, -big };
+  for (const auto& tri : triangles) {
+    for (const auto& v : tri.v) {
+      low = { std::min(low.x, v.x), std::min(low.y, v.y), std::min(low.z, v.z) };
+      high = { std::max(high.x, v.x), std::max(high.y, v.y), std::max(high.z, v.z) };
+    }
+  }
+  if (triangles.empty())
+    return { 0, 0, 0 };
+  return (low + high) / 2;
+}
+
+Matrix4 modelMatrix(const Camera& camera, Vector3 center) {
+  return translation(center) * rotationY(camera.modelYaw) * translation(-center);
+}
+
+// scene space is left-handed, x right, y up and z into the screen, so
+// view space x is mirrored to keep the right of the scene on the right
+Matrix4 viewMatrix(const Camera& camera) {
+  return scaling({ -1, 1, 1 }) * lookAt(camera.eye, camera.target, camera.up);
+}
+
+Matrix4 projectionMatrix(const Camera& camera, Viewport viewport) {
+  return perspective(camera.fov, (float)viewport.width / viewport.height, camera.near,
+                     camera.far);
+}
+
+void transformScene(const std::vector<triangle>& triangles, const std::vector<light>& lights,
+                    const Camera& camera, Vector3 center, Viewport viewport,
+                    std::vector<triangle>& outTriangles, std::vector<light>& outLights,
+                    std::vector<std::size_t>* sources) {
+  TRACE_SCOPE("transform");
+  Matrix4 modelView = viewMatrix(camera) * modelMatrix(camera, center);
+  Matrix4 clipFromModel = projectionMatrix(camera, viewport) * modelView;
+  Matrix4 normals = normalMatrix(modelView);
+
+  // every vertex, structure-of-arrays
+  int count = triangles.size() * 3;
+  std::vector<float> in(6 * count), clipped(7 * count);
+  float* px = &in[0];
+  float* py = px + count;
+  float* pz = py + count;
+  float* nx = pz + count;
+  float* ny = nx + count;
+  float* nz = ny + count;
+  for (int i = 0; i < count; ++i) {
+    const vertex& v = triangles[i / 3].v[i % 3];
+    px[i] = v.x, py[i] = v.y, pz[i] = v.z;
+    nx[i] = v.nx, ny[i] = v.ny, nz[i] = v.nz;
+  }
+  float* clipRows[4] = { &clipped[0], &clipped[count], &clipped[2 * count], &clipped[3 * count] };
+  float* normalRows[3] = { &clipped[4 * count], &clipped[5 * count], &clipped[6 * count] };
+  transformPoints(clipFromModel, px, py, pz, clipRows, 4, count);
+  transformPoints(normals, nx, ny, nz, normalRows, 3, count);
+  Vector3Batch normalBatch = { normalRows[0], normalRows[1], normalRows[2] };
+  normalize(normalBatch, normalBatch, count);
+
+  outTriangles.clear();
+  outTriangles.reserve(triangles.size());
+  if (sources)
+    sources->clear();
+  for (std::size_t t = 0; t < triangles.size(); ++t) {
+    ClipVertex corners[3];
+    bool inside = true;
+    for (int k = 0; k < 3; ++k) {
+      int i = t * 3 + k;
+      const vertex& v = triangles[t].v[k];
+      // view space looks down -z, screen space depth grows away from the eye
+      corners[k] = { clipRows[0][i], clipRows[1][i], clipRows[2][i], clipRows[3][i],
+                     normalRows[0][i], normalRows[1][i], -normalRows[2][i], v.u, v.v };
+      inside = inside && corners[k].z + corners[k].w >= 0 &&
+               onScreen(toScreen(corners[k], viewport), viewport);
+    }
+    if (!inside) {
+      clipTriangle(triangles[t], corners, viewport, outTriangles);
+      if (sources)
+        sources->resize(outTriangles.size(), t);
+      continue;
+    }
+    triangle tri = triangles[t];
+    for (int k = 0; k < 3; ++k)
+      tri.v[k] = toVertex(toScreen(corners[k], viewport));
+    outTriangles.push_back(tri);
+    if (sources)
+      sources->push_back(t);
+  }
+
+  // lights take the same path as vertices, from wherever they end up
+  outLights = lights;
+  for (auto& l : outLights) {
+    float* rows[4];
+    float position[4];
+    for (int r = 0; r < 4; ++r)
+      rows[r] = &position[r];
+    transformPoints(clipFromModel, &l.x, &l.y, &l.z, rows, 4, 1);
+    ClipVertex v = { position[0], position[1], position[2], position[3] };
+    // a light behind the eye is placed as if it were on the near plane
+    if (v.w <= 0)
+      v.w = camera.near;
+    v = toScreen(v, viewport);
+    l.x = v.x, l.y = v.y, l.z = v.z;
+  }
+}
+
+void clipToViewport(const triangle& tri, Viewport viewport, std::vector<triangle>& out) {
+  std::vector<ClipVertex> polygon;
+  bool inside = true;
+  for (const auto& v : tri.v) {
+    polygon.push_back({ v.x, v.y, v.z, 1, v.nx, v.ny, v.nz, v.u, v.v });
+    inside = inside && onScreen(polygon.back(), viewport);
+  }
+  if (inside)
+    out.push_back(tri);
+  else
+    clipToScreen(polygon, tri, viewport, out);
+}
@@ -0,0 +1,58 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <vector>
+
+#include "scene/scene.hh"
+#include "util/matrix4.hh"
+#include "util/vector3.hh"
+
+// A camera looking at the scene, whose coordinates are then taken as
+// world space instead of screen space
+struct Camera {
+  Vector3 eye;
+  Vector3 target;
+  Vector3 up = { 0, 1, 0 };
+  float fov = 60;	// vertical, degrees
+  float near = 1, far = 10000;
+  float modelYaw = 0;	// degrees the scene turns about its center first
+};
+
+// Screen space a view renders into: pixels, and depth in [0, depth]
+struct Viewport {
+  int width, height;
+  float depth;
+};
+
+// center of the bounding box of the triangles
+Vector3 sceneCenter(const std::vector<triangle>& triangles);
+
+// Model, view and projection of the camera, with the scene turning about
+// center
+Matrix4 modelMatrix(const Camera& camera, Vector3 center);
+Matrix4 viewMatrix(const Camera& camera);
+Matrix4 projectionMatrix(const Camera& camera, Viewport viewport);
+
+// Transforms triangles and lights into the viewport as seen by the
+// camera: positions through the model, view and projection matrices,
+// perspective divide and viewport mapping, four vertices at a time;
+// normals through the inverse transpose of the model-view matrix.
+// Triangles are clipped against the near plane and the viewport edges,
+// so every one written lies on screen. sources, if given, receives the
+// index of the triangle each written one came from.
+void transformScene(const std::vector<triangle>& triangles, const std::vector<light>& lights,
+                    const Camera& camera, Vector3 center, Viewport viewport,
+                    std::vector<triangle>& outTriangles, std::vector<light>& outLights,
+                    std::vector<std::size_t>* sources = nullptr);
+
+// Clips a screen space triangle to the viewport and appends what is left
+// of it, fanned into triangles whose vertices are rounded to whole pixels
+// like those of scene files. A triangle on screen is appended as it is.
+void clipToViewport(const triangle& tri, Viewport viewport, std::vector<triangle>& out);
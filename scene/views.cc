@@ -0,0 +1,62 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "views.hh"
+#include "util/parse.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+bool loadViews(const std::string& path, std::vector<View>& views, std::string& error) {
+  std::ifstream file(path);
+  if (!file) {
+    error = "Could not open " + path;
+    return false;
+  }
+  std::string line;
+  for (int number = 1; std::getline(file, line); ++number) {
+    std::istringstream words(line);
+    View view;
+    std::string eye;
+    if (!(words >> view.output) || view.output[0] == '#')
+      continue;
+    std::string where = path + ":" + std::to_string(number) + ": ";
+    if (!(words >> eye) || !parseVector3(eye, view.camera.eye)) {
+      error = where + "expected a camera position X,Y,Z";
+      return false;
+    }
+    std::string key, value;
+    while (words >> key) {
+      if (!(words >> value)) {
+        error = where + "missing value for " + key;
+        return false;
+      }
+      if (key == "look-at" && parseVector3(value, view.camera.target)) {
+        view.lookAtSet = true;
+      } else if (key == "fov") {
+        view.camera.fov = atof(value.c_str());
+        if (view.camera.fov <= 0 || view.camera.fov >= 180) {
+          error = where + "field of view must be between 0 and 180 degrees";
+          return false;
+        }
+      } else if (key == "yaw") {
+        view.camera.modelYaw = atof(value.c_str());
+      } else {
+        error = where + "bad " + key + " " + value;
+        return false;
+      }
+    }
+    views.push_back(view);
+  }
+  if (views.empty()) {
+    error = path + " has no views";
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,26 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "scene/vertexTransform.hh"
+
+// One camera of a multi-view run and the image it renders to
+struct View {
+  Camera camera;
+  bool lookAtSet = false;	// otherwise the camera looks at the scene's center
+  std::string output;
+};
+
+// Reads a views file, one view per line:
+//   OUTPUT.ppm X,Y,Z [look-at X,Y,Z] [fov DEGREES] [yaw DEGREES]
+// Blank lines and lines starting with # are skipped.
+bool loadViews(const std::string& path, std::vector<View>& views, std::string& error);
@@ -0,0 +1,144 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+// Checks that every Vector3Batch operation gives bitwise what the Vector3
+// function of the same name gives for each element, over whole batches of
+// four and the leftover elements, in place where allowed, and for zero,
+// tiny, huge and negative components. Built twice by make check, with the
+// Vector4 intrinsics and with -DA5_SCALAR_MATH.
+
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "util/vector3.hh"
+#include "util/vectorBatch.hh"
+
+using namespace std;
+
+namespace {
+
+int failures = 0;
+
+bool sameBits(float a, float b) {
+  return memcmp(&a, &b, sizeof(float)) == 0;
+}
+
+void expect(const string& what, int count, int i, float batch, float scalar) {
+  if (sameBits(batch, scalar))
+    return;
+  if (++failures <= 10)
+    cout << what << " of " << count << ", element " << i << ": " << batch << " but "
+         << scalar << " per element" << endl;
+}
+
+void expect(const string& what, int count, int i, Vector3 batch, Vector3 scalar) {
+  expect(what + " x", count, i, batch.x, scalar.x);
+  expect(what + " y", count, i, batch.y, scalar.y);
+  expect(what + " z", count, i, batch.z, scalar.z);
+}
+
+// count vectors structure-of-arrays, owning their storage
+struct Vectors {
+  vector<float> x, y, z;
+
+  explicit Vectors(int count) : x(count), y(count), z(count) {}
+  Vector3Batch batch() { return { x.data(), y.data(), z.data() }; }
+};
+
+float component(default_random_engine& generator) {
+  // mostly ordinary values, with some that take the edge cases
+  static const float special[] = { 0.0f, -0.0f, 1e-20f, -1e-20f, 1e20f, -1e20f, 1.0f };
+  uniform_int_distribution<int> pick(0, 9);
+  int choice = pick(generator);
+  if (choice < 7 && pick(generator) == 0)
+    return special[choice];
+  return uniform_real_distribution<float>(-1000, 1000)(generator);
+}
+
+Vectors randomVectors(default_random_engine& generator, int count) {
+  Vectors vectors(count);
+  for (int i = 0; i < count; ++i) {
+    vectors.x[i] = component(generator);
+    vectors.y[i] = component(generator);
+    vectors.z[i] = component(generator);
+  }
+  // a zero vector, which normalizes to zero
+  if (count > 2)
+    vectors.x[2] = vectors.y[2] = vectors.z[2] = 0;
+  return vectors;
+}
+
+void check(default_random_engine& generator, int count) {
+  Vectors u = randomVectors(generator, count), v = randomVectors(generator, count);
+  Vector3Batch ub = u.batch(), vb = v.batch();
+  vector<float> t(count);
+  for (float& weight : t)
+    weight = uniform_real_distribution<float>(-0.5f, 1.5f)(generator);
+
+  Vectors normalized(count);
+  normalize(ub, normalized.batch(), count);
+  for (int i = 0; i < count; ++i)
+    expect("normalize", count, i, normalized.batch().get(i), normalize(ub.get(i)));
+
+  vector<float> dots(count);
+  dot(ub, vb, dots.data(), count);
+  for (int i = 0; i < count; ++i)
+    expect("dot", count, i, dots[i], dot(ub.get(i), vb.get(i)));
+
+  Vectors crossed(count);
+  cross(ub, vb, crossed.batch(), count);
+  for (int i = 0; i < count; ++i)
+    expect("cross", count, i, crossed.batch().get(i), cross(ub.get(i), vb.get(i)));
+
+  Vectors lerped(count);
+  lerp(ub, vb, t.data(), lerped.batch(), count);
+  for (int i = 0; i < count; ++i)
+    expect("lerp", count, i, lerped.batch().get(i), lerp(ub.get(i), vb.get(i), t[i]));
+
+  // in place, where the operations allow it
+  Vectors inPlace = u;
+  normalize(inPlace.batch(), inPlace.batch(), count);
+  for (int i = 0; i < count; ++i)
+    expect("normalize in place", count, i, inPlace.batch().get(i), normalized.batch().get(i));
+  inPlace = u;
+  lerp(inPlace.batch(), vb, t.data(), inPlace.batch(), count);
+  for (int i = 0; i < count; ++i)
+    expect("lerp into a", count, i, inPlace.batch().get(i), lerped.batch().get(i));
+  inPlace = v;
+  lerp(ub, inPlace.batch(), t.data(), inPlace.batch(), count);
+  for (int i = 0; i < count; ++i)
+    expect("lerp into b", count, i, inPlace.batch().get(i), lerped.batch().get(i));
+}
+
+}
+
+int main() {
+  default_random_engine generator(441);
+  cout << setprecision(9);
+  // every leftover count after whole batches of four, then larger batches
+  for (int count = 0; count <= 16; ++count)
+    check(generator, count);
+  for (int round = 0; round < 100; ++round)
+    check(generator, 1000 + round);
+#ifdef A5_SCALAR_MATH
+  const char* lanes = "scalar";
+#else
+  const char* lanes = "vector";
+#endif
+  if (failures) {
+    cout << "vectorBatch (" << lanes << "): " << failures << " mismatches" << endl;
+    return 1;
+  }
+  cout << "vectorBatch (" << lanes << "): every element matches" << endl;
+  return 0;
+}
@@ -0,0 +1,149 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "bc1.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <utility>
+
+#include "util/clamp.hh"
+
+namespace BC1 {
+
+namespace {
+
+std::uint16_t pack565(const float rgb[3]) {
+  int r = (int)(clamp(0, 1, rgb[0]) * 31 + 0.5f);
+  int g = (int)(clamp(0, 1, rgb[1]) * 63 + 0.5f);
+  int b = (int)(clamp(0, 1, rgb[2]) * 31 + 0.5f);
+  return (std::uint16_t)((r << 11) | (g << 5) | b);
+}
+
+void unpack565(std::uint16_t color, int rgb[3]) {
+  int r = (color >> 11) & 31;
+  int g = (color >> 5) & 63;
+  int b = color & 31;
+  rgb[0] = (r << 3) | (r >> 2);
+  rgb[1] = (g << 2) | (g >> 4);
+  rgb[2] = (b << 3) | (b >> 2);
+}
+
+std::uint16_t readEndpoint(const unsigned char* bytes) {
+  return (std::uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+void writeEndpoint(unsigned char* bytes, std::uint16_t color) {
+  bytes[0] = color & 0xff;
+  bytes[1] = color >> 8;
+}
+
+// the four colors a block can select from, in 0-255
+void palette(std::uint16_t c0, std::uint16_t c1, int colors[4][3]) {
+  unpack565(c0, colors[0]);
+  unpack565(c1, colors[1]);
+  for (int c = 0; c < 3; ++c) {
+    if (c0 > c1) {
+      colors[2][c] = (2 * colors[0][c] + colors[1][c]) / 3;
+      colors[3][c] = (colors[0][c] + 2 * colors[1][c]) / 3;
+    } else {
+      colors[2][c] = (colors[0][c] + colors[1][c]) / 2;
+      colors[3][c] = 0;
+    }
+  }
+}
+
+// direction of greatest color variance, by power iteration
+void principalAxis(const float texels[16][3], const float mean[3], float axis[3]) {
+  float covariance[3][3] = {};
+  for (int t = 0; t < 16; ++t)
+    for (int a = 0; a < 3; ++a)
+      for (int b = 0; b < 3; ++b)
+        covariance[a][b] += (texels[t][a] - mean[a]) * (texels[t][b] - mean[b]);
+
+  axis[0] = axis[1] = axis[2] = 1;
+  for (int iteration = 0; iteration < 8; ++iteration) {
+    float next[3];
+    for (int a = 0; a < 3; ++a)
+      next[a] = covariance[a][0] * axis[0] + covariance[a][1] * axis[1] + covariance[a][2] * axis[2];
+    float length = std::sqrt(next[0] * next[0] + next[1] * next[1] + next[2] * next[2]);
+    if (length == 0)
+      return;
+    for (int a = 0; a < 3; ++a)
+      axis[a] = next[a] / length;
+  }
+}
+
+}
+
+void encodeBlock(const float texels[16][3], unsigned char* block) {
+  float mean[3] = {};
+  for (int t = 0; t < 16; ++t)
+    for (int c = 0; c < 3; ++c)
+      mean[c] += texels[t][c] / 16;
+
+  float axis[3];
+  principalAxis(texels, mean, axis);
+  float low = 0, high = 0;
+  for (int t = 0; t < 16; ++t) {
+    float projection = 0;
+    for (int c = 0; c < 3; ++c)
+      projection += (texels[t][c] - mean[c]) * axis[c];
+    low = std::min(low, projection);
+    high = std::max(high, projection);
+  }
+
+  float ends[2][3];
+  for (int c = 0; c < 3; ++c) {
+    ends[0][c] = mean[c] + axis[c] * high;
+    ends[1][c] = mean[c] + axis[c] * low;
+  }
+  std::uint16_t c0 = pack565(ends[0]);
+  std::uint16_t c1 = pack565(ends[1]);
+  // c0 > c1 selects the four color mode
+  if (c0 < c1)
+    std::swap(c0, c1);
+
+  int colors[4][3];
+  palette(c0, c1, colors);
+  std::uint32_t indices = 0;
+  for (int t = 0; t < 16; ++t) {
+    int best = 0;
+    float bestError = -1;
+    for (int p = 0; p < (c0 > c1 ? 4 : 3); ++p) {
+      float error = 0;
+      for (int c = 0; c < 3; ++c) {
+        float delta = texels[t][c] * 255 - colors[p][c];
+        error += delta * delta;
+      }
+      if (bestError < 0 || error < bestError) {
+        best = p;
+        bestError = error;
+      }
+    }
+    indices |= (std::uint32_t)best << (2 * t);
+  }
+
+  writeEndpoint(block, c0);
+  writeEndpoint(block + 2, c1);
+  for (int b = 0; b < 4; ++b)
+    block[4 + b] = (indices >> (8 * b)) & 0xff;
+}
+
+void decodeTexel(const unsigned char* block, int i, int j, float& R, float& G, float& B) {
+  int colors[4][3];
+  palette(readEndpoint(block), readEndpoint(block + 2), colors);
+  int t = j * blockSize + i;
+  int index = (block[4 + t / 4] >> (2 * (t % 4))) & 3;
+  R = colors[index][0] / 255.0f;
+  G = colors[index][1] / 255.0f;
+  B = colors[index][2] / 255.0f;
+}
+
+}
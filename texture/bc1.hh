@@ -0,0 +1,24 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+// BC1 (DXT1) block compression: a 4x4 block of texels is stored in 8 bytes
+// as two RGB565 endpoints and a 2 bit palette index per texel
+namespace BC1 {
+
+const int blockSize = 4;
+const int blockBytes = 8;
+
+// texels[j * 4 + i] is the texel at x + i, y + j within the block
+void encodeBlock(const float texels[16][3], unsigned char* block);
+
+// decode the single texel at (i, j) within the block
+void decodeTexel(const unsigned char* block, int i, int j, float& R, float& G, float& B);
+
+}
@@ -0,0 +1,301 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "texture.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+
+#include "bc1.hh"
+#include "virtualTexture.hh"
+#include "util/clamp.hh"
+
+namespace {
+
+struct NamedFormat {
+  const char* name;
+  TextureFormat format;
+};
+
+const NamedFormat formats[] = {
+  { "float", TextureFormat::Float },
+  { "rgb8", TextureFormat::RGB8 },
+  { "bc1", TextureFormat::BC1 },
+};
+
+// header of a texture file, followed by textureBytes of texels
+struct FileHeader {
+  char magic[4];
+  std::uint32_t version;
+  std::uint32_t format;
+  std::int32_t xsize, ysize;
+};
+
+const char fileMagic[4] = { 'A', '5', 'T', 'X' };
+// version 2 files are tiled, the header is followed by the tile size and
+// then every tile, row by row, each stored like a texture of its own
+const std::uint32_t fileVersion = 1;
+const std::uint32_t tiledFileVersion = 2;
+
+int blocksAcross(int size) {
+  return (size + BC1::blockSize - 1) / BC1::blockSize;
+}
+
+std::size_t storageBytes(TextureFormat format, int xsize, int ysize) {
+  switch (format) {
+  case TextureFormat::RGB8:
+    return (std::size_t)xsize * ysize * 3;
+  case TextureFormat::BC1:
+    return (std::size_t)blocksAcross(xsize) * blocksAcross(ysize) * BC1::blockBytes;
+  default:
+    return (std::size_t)xsize * ysize * 3 * sizeof(float);
+  }
+}
+
+// texels are stored column major, as in the scene files
+void texelAt(const texture* t, int x, int y, float& R, float& G, float& B) {
+  switch (t->format) {
+  case TextureFormat::RGB8: {
+    const unsigned char* texel = &t->packed[3 * (x * t->ysize + y)];
+    R = texel[0] / 255.0f;
+    G = texel[1] / 255.0f;
+    B = texel[2] / 255.0f;
+    break;
+  }
+  case TextureFormat::BC1: {
+    int block = (y / BC1::blockSize) * blocksAcross(t->xsize) + x / BC1::blockSize;
+    BC1::decodeTexel(&t->packed[block * BC1::blockBytes],
+                     x % BC1::blockSize, y % BC1::blockSize, R, G, B);
+    break;
+  }
+  default: {
+    const float* texel = &t->elements[3 * (x * t->ysize + y)];
+    R = texel[0];
+    G = texel[1];
+    B = texel[2];
+  }
+  }
+}
+
+}
+
+bool parseTextureFormat(const std::string& name, TextureFormat& format) {
+  for (auto named : formats) {
+    if (name == named.name) {
+      format = named.format;
+      return true;
+    }
+  }
+  return false;
+}
+
+const char* textureFormatName(TextureFormat format) {
+  return formats[(int)format].name;
+}
+
+void getTextureRGB(const texture* t, float u, float v, float& R, float& G, float& B) {
+  int xval,yval;
+  if (u<1.0) 
+    if (u>=0.0) xval = (int)(u*t->xsize);
+    else xval = 0;
+  else xval = t->xsize-1;
+  if (v<1.0) 
+    if (v>=0.0) yval = (int)(v*t->ysize);
+    else yval = 0;
+  else yval = t->ysize-1;
+
+  if (t->tiles) {
+    const VirtualTexture& vt = *t->tiles;
+    int tileSize = vt.getTileSize();
+    const texture* tile = fetchTile(vt, (yval / tileSize) * vt.getTilesX() + xval / tileSize);
+    if (tile->xsize == 0) {
+      R = G = B = 0;
+      return;
+    }
+    texelAt(tile, xval % tileSize, yval % tileSize, R, G, B);
+    return;
+  }
+
+  texelAt(t, xval, yval, R, G, B);
+}
+
+void convertTexture(texture& t, TextureFormat format) {
+  if (t.format == format || t.tiles)
+    return;
+
+  std::vector<float> rgb(3 * t.xsize * t.ysize);
+  for (int x = 0; x < t.xsize; ++x)
+    for (int y = 0; y < t.ysize; ++y) {
+      float* texel = &rgb[3 * (x * t.ysize + y)];
+      texelAt(&t, x, y, texel[0], texel[1], texel[2]);
+    }
+
+  t.format = format;
+  t.elements.clear();
+  t.packed.assign(storageBytes(format, t.xsize, t.ysize), 0);
+  switch (format) {
+  case TextureFormat::Float:
+    t.elements.swap(rgb);
+    t.packed.clear();
+    break;
+  case TextureFormat::RGB8:
+    for (std::size_t i = 0; i < rgb.size(); ++i)
+      t.packed[i] = (unsigned char)(clamp(0, 1, rgb[i]) * 255 + 0.5f);
+    break;
+  case TextureFormat::BC1: {
+    // blocks hanging over the edge repeat the last row and column
+    float block[16][3];
+    for (int by = 0; by < blocksAcross(t.ysize); ++by)
+      for (int bx = 0; bx < blocksAcross(t.xsize); ++bx) {
+        for (int j = 0; j < BC1::blockSize; ++j)
+          for (int i = 0; i < BC1::blockSize; ++i) {
+            int x = std::min(bx * BC1::blockSize + i, t.xsize - 1);
+            int y = std::min(by * BC1::blockSize + j, t.ysize - 1);
+            std::memcpy(block[j * BC1::blockSize + i], &rgb[3 * (x * t.ysize + y)], 3 * sizeof(float));
+          }
+        BC1::encodeBlock(block, &t.packed[(by * blocksAcross(t.xsize) + bx) * BC1::blockBytes]);
+      }
+    break;
+  }
+  }
+}
+
+std::size_t textureBytes(const texture& t) {
+  if (t.tiles)
+    return 0;
+  return storageBytes(t.format, t.xsize, t.ysize);
+}
+
+bool inlineTexture(const std::string& first) {
+  // "2" or "2.0", but not a file called "1wood.ppm"
+  char* end;
+  std::strtod(first.c_str(), &end);
+  return !first.empty() && end == first.c_str() + first.size();
+}
+
+bool readTexture(TokenReader& in, const std::string& directory, texture& t) {
+  std::string first = in.nextWord();
+  if (in.fail)
+    return false;
+  if (!inlineTexture(first)) {
+    std::string path = first[0] == '/' || directory.empty() ? first : directory + "/" + first;
+    return loadTextureFile(path, t);
+  }
+
+  t.xsize = std::atoi(first.c_str());
+  t.ysize = in.nextInt();
+  if (in.fail || t.xsize <= 0 || t.ysize <= 0)
+    return false;
+  t.format = TextureFormat::Float;
+  t.packed.clear();
+  t.tiles.reset();
+  t.elements.resize(t.xsize * t.ysize * 3);
+  for (float& element : t.elements)
+    element = in.nextFloat();
+  return !in.fail;
+}
+
+bool loadTextureFile(const std::string& path, texture& t) {
+  std::ifstream in(path, std::ios::binary);
+  FileHeader header;
+  if (!in.read((char*)&header, sizeof(header)))
+    return false;
+  if (std::memcmp(header.magic, fileMagic, sizeof(fileMagic)) != 0 ||
+      (header.version != fileVersion && header.version != tiledFileVersion) ||
+      header.format > (std::uint32_t)TextureFormat::BC1 ||
+      header.xsize <= 0 || header.ysize <= 0)
+    return false;
+
+  t.xsize = header.xsize;
+  t.ysize = header.ysize;
+  t.format = (TextureFormat)header.format;
+  t.elements.clear();
+  t.packed.clear();
+  t.tiles.reset();
+
+  if (header.version == tiledFileVersion) {
+    std::int32_t tileSize;
+    if (!in.read((char*)&tileSize, sizeof(tileSize)) || tileSize <= 0 ||
+        (t.format == TextureFormat::BC1 && tileSize % BC1::blockSize != 0))
+      return false;
+    t.tiles = std::make_shared<VirtualTexture>(path, t.format, t.xsize, t.ysize, tileSize,
+                                               (long)(sizeof(header) + sizeof(tileSize)));
+    return t.tiles->isOpen();
+  }
+
+  std::size_t bytes = textureBytes(t);
+  if (t.format == TextureFormat::Float) {
+    t.elements.resize(bytes / sizeof(float));
+    in.read((char*)t.elements.data(), bytes);
+  } else {
+    t.packed.resize(bytes);
+    in.read((char*)t.packed.data(), bytes);
+  }
+  return (bool)in;
+}
+
+bool saveTextureFile(const std::string& path, const texture& t) {
+  if (t.tiles)
+    return false;
+  std::ofstream out(path, std::ios::binary);
+  FileHeader header;
+  std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+  header.version = fileVersion;
+  header.format = (std::uint32_t)t.format;
+  header.xsize = t.xsize;
+  header.ysize = t.ysize;
+  out.write((const char*)&header, sizeof(header));
+  if (t.format == TextureFormat::Float)
+    out.write((const char*)t.elements.data(), textureBytes(t));
+  else
+    out.write((const char*)t.packed.data(), textureBytes(t));
+  return (bool)out;
+}
+
+bool saveTiledTextureFile(const std::string& path, const texture& t, int tileSize) {
+  if (t.tiles || tileSize <= 0 ||
+      (t.format == TextureFormat::BC1 && tileSize % BC1::blockSize != 0))
+    return false;
+  std::ofstream out(path, std::ios::binary);
+  FileHeader header;
+  std::memcpy(header.magic, fileMagic, sizeof(fileMagic));
+  header.version = tiledFileVersion;
+  header.format = (std::uint32_t)t.format;
+  header.xsize = t.xsize;
+  header.ysize = t.ysize;
+  std::int32_t size = tileSize;
+  out.write((const char*)&header, sizeof(header));
+  out.write((const char*)&size, sizeof(size));
+
+  // tiles hanging over the edge repeat the last row and column
+  int tilesX = (t.xsize + tileSize - 1) / tileSize;
+  int tilesY = (t.ysize + tileSize - 1) / tileSize;
+  texture tile;
+  for (int ty = 0; ty < tilesY; ++ty)
+    for (int tx = 0; tx < tilesX; ++tx) {
+      tile.xsize = tile.ysize = tileSize;
+      tile.format = TextureFormat::Float;
+      tile.packed.clear();
+      tile.elements.resize(3 * tileSize * tileSize);
+      for (int x = 0; x < tileSize; ++x)
+        for (int y = 0; y < tileSize; ++y) {
+          float* texel = &tile.elements[3 * (x * tileSize + y)];
+          texelAt(&t, std::min(tx * tileSize + x, t.xsize - 1),
+                  std::min(ty * tileSize + y, t.ysize - 1), texel[0], texel[1], texel[2]);
+        }
+      convertTexture(tile, t.format);
+      if (t.format == TextureFormat::Float)
+        out.write((const char*)tile.elements.data(), textureBytes(tile));
+      else
+        out.write((const char*)tile.packed.data(), textureBytes(tile));
+    }
+  return (bool)out;
+}
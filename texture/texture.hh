@@ -0,0 +1,64 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "util/tokenReader.hh"
+
+// How texels are kept in memory
+//   Float: 3 floats per texel, 12 bytes
+//   RGB8:  3 bytes per texel
+//   BC1:   8 bytes per 4x4 block, half a byte per texel
+enum class TextureFormat { Float, RGB8, BC1 };
+
+bool parseTextureFormat(const std::string& name, TextureFormat& format);
+const char* textureFormatName(TextureFormat format);
+
+class VirtualTexture;
+
+struct texture {
+  // Note access using getTextureRGB
+  int xsize, ysize;	// The size of the texture in x and y
+  TextureFormat format;
+  std::vector<float> elements;	// RGB values when format is Float
+  std::vector<unsigned char> packed;	// RGB8 texels or BC1 blocks
+  std::shared_ptr<VirtualTexture> tiles;	// set when texels are paged in from a tiled file
+};
+
+// Pass in a pointer to the texture, t, and the texture coordinates, u and v
+// Returns (in R,G,B) the color of the texture at those coordinates
+void getTextureRGB(const texture* t, float u, float v, float& R, float& G, float& B);
+
+// re-encode the texels of t in another format
+void convertTexture(texture& t, TextureFormat format);
+
+// bytes held by the texel storage of t, 0 for a virtual texture whose
+// tiles live in the tile cache
+std::size_t textureBytes(const texture& t);
+
+// Whether the first token of a texture entry starts an inline texture,
+// i.e. is a whole number, rather than naming a texture file
+bool inlineTexture(const std::string& first);
+
+// Read one texture entry of a scene file. The entry is either inline,
+// "xsize ysize" followed by the float RGB texels, or the name of a texture
+// file written by tools/texcompress, relative to directory.
+// returns false on malformed input
+bool readTexture(TokenReader& in, const std::string& directory, texture& t);
+
+// Binary texture files keep the texels in their stored format. Tiled files
+// load as virtual textures whose tiles are read on demand.
+bool loadTextureFile(const std::string& path, texture& t);
+bool saveTextureFile(const std::string& path, const texture& t);
+// tileSize must be a multiple of 4 for BC1
+bool saveTiledTextureFile(const std::string& path, const texture& t, int tileSize);
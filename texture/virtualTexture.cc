@@ -0,0 +1,193 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "virtualTexture.hh"
+
+#include <atomic>
+#include <fcntl.h>
+#include <list>
+#include <mutex>
+#include <unistd.h>
+#include <unordered_map>
+#include <utility>
+
+#include "trace/trace.hh"
+
+namespace {
+
+std::atomic<std::uint64_t> nextId(1);
+
+struct Resident {
+  std::uint64_t key;
+  std::shared_ptr<const texture> tile;
+  std::size_t bytes;
+};
+
+// most recently used tiles are at the front of the list
+struct TileCache {
+  std::mutex mutex;
+  std::list<Resident> tiles;
+  std::unordered_map<std::uint64_t, std::list<Resident>::iterator> index;
+  TileCacheStats stats = { 0, 0, 0, 0, 0, 0, 256 << 20 };
+
+  // drop tiles from the back until within budget, always keeping one
+  void evict() {
+    while (stats.residentBytes > stats.budget && tiles.size() > 1) {
+      stats.residentBytes -= tiles.back().bytes;
+      index.erase(tiles.back().key);
+      tiles.pop_back();
+      ++stats.evictions;
+    }
+  }
+};
+
+TileCache cache;
+
+// The tile each thread fetched last. Rasterizing hits the same tile for
+// many texels in a row, and those lookups take neither the lock nor a
+// reference. Tiles evicted meanwhile stay alive until the thread moves on.
+struct LastTile {
+  std::uint64_t key = 0;	// no tile has key 0, ids start at 1
+  std::shared_ptr<const texture> tile;
+};
+thread_local LastTile lastTile;
+
+// hits on lastTile, counted apart for every thread (threads beyond the
+// number of counters share them) so counting shares no cache line
+struct alignas(64) HitCounter {
+  std::atomic<std::uint64_t> hits;
+};
+const unsigned hitCounterCount = 64;
+HitCounter hitCounters[hitCounterCount];
+std::atomic<unsigned> nextHitCounter(0);
+thread_local HitCounter* hitCounter = &hitCounters[nextHitCounter++ % hitCounterCount];
+
+std::uint64_t tileKey(const VirtualTexture& vt, int tile) {
+  return (vt.getId() << 32) | (std::uint32_t)tile;
+}
+
+}
+
+VirtualTexture::VirtualTexture(const std::string& path, TextureFormat format,
+                               int xsize, int ysize, int tileSize, long dataOffset)
+  : fd(open(path.c_str(), O_RDONLY)), format(format), tileSize(tileSize),
+    tilesX((xsize + tileSize - 1) / tileSize), tilesY((ysize + tileSize - 1) / tileSize),
+    dataOffset(dataOffset), id(nextId++) {}
+
+VirtualTexture::~VirtualTexture() {
+  if (fd >= 0)
+    close(fd);
+}
+
+std::size_t VirtualTexture::tileBytes() const {
+  texture tile;
+  tile.xsize = tile.ysize = tileSize;
+  tile.format = format;
+  return textureBytes(tile);
+}
+
+bool VirtualTexture::readTile(int tile, texture& out) const {
+  TRACE_SCOPE("readTile");
+  std::size_t bytes = tileBytes();
+  out.xsize = out.ysize = tileSize;
+  out.format = format;
+  out.elements.clear();
+  out.packed.clear();
+  unsigned char* destination;
+  if (format == TextureFormat::Float) {
+    out.elements.resize(bytes / sizeof(float));
+    destination = (unsigned char*)out.elements.data();
+  } else {
+    out.packed.resize(bytes);
+    destination = out.packed.data();
+  }
+  off_t offset = dataOffset + (off_t)tile * bytes;
+  std::size_t done = 0;
+  while (done < bytes) {
+    ssize_t count = pread(fd, destination + done, bytes - done, offset + done);
+    if (count <= 0)
+      return false;
+    done += count;
+  }
+  return true;
+}
+
+void setTileCacheBudget(std::size_t bytes) {
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.stats.budget = bytes;
+  cache.evict();
+}
+
+TileCacheStats tileCacheStats() {
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  TileCacheStats stats = cache.stats;
+  for (const auto& counter : hitCounters) {
+    std::uint64_t hits = counter.hits.load(std::memory_order_relaxed);
+    stats.lookups += hits;
+    stats.hits += hits;
+  }
+  return stats;
+}
+
+void resetTileCacheStats() {
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.stats.lookups = cache.stats.hits = cache.stats.misses = 0;
+  cache.stats.evictions = cache.stats.bytesLoaded = 0;
+  for (auto& counter : hitCounters)
+    counter.hits.store(0, std::memory_order_relaxed);
+}
+
+namespace {
+
+// the tile from the cache, or faulted in from disk
+std::shared_ptr<const texture> fetchSharedTile(const VirtualTexture& vt, int tile,
+                                               std::uint64_t key) {
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    ++cache.stats.lookups;
+    auto found = cache.index.find(key);
+    if (found != cache.index.end()) {
+      ++cache.stats.hits;
+      cache.tiles.splice(cache.tiles.begin(), cache.tiles, found->second);
+      return found->second->tile;
+    }
+    ++cache.stats.misses;
+  }
+
+  // read without holding the lock, another thread may fault the same tile
+  // in meanwhile, in which case its copy wins
+  std::shared_ptr<texture> loaded = std::make_shared<texture>();
+  if (!vt.readTile(tile, *loaded)) {
+    loaded->xsize = loaded->ysize = 0;
+    return loaded;
+  }
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.stats.bytesLoaded += vt.tileBytes();
+  auto found = cache.index.find(key);
+  if (found != cache.index.end())
+    return found->second->tile;
+  cache.tiles.push_front({ key, loaded, vt.tileBytes() });
+  cache.index[key] = cache.tiles.begin();
+  cache.stats.residentBytes += vt.tileBytes();
+  cache.evict();
+  return loaded;
+}
+
+}
+
+const texture* fetchTile(const VirtualTexture& vt, int tile) {
+  std::uint64_t key = tileKey(vt, tile);
+  if (lastTile.key == key) {
+    hitCounter->hits.fetch_add(1, std::memory_order_relaxed);
+    return lastTile.tile.get();
+  }
+  lastTile.tile = fetchSharedTile(vt, tile, key);
+  lastTile.key = key;
+  return lastTile.tile.get();
+}
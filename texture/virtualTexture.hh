@@ -0,0 +1,65 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "texture.hh"
+
+// A texture whose texels stay in a tiled texture file. Tiles are faulted
+// into a cache shared by all virtual textures when a lookup touches them
+// and the least recently used tiles are dropped to stay within budget.
+class VirtualTexture {
+public:
+  // tiles start at dataOffset in the file, row by row
+  VirtualTexture(const std::string& path, TextureFormat format,
+                 int xsize, int ysize, int tileSize, long dataOffset);
+  ~VirtualTexture();
+
+  VirtualTexture(const VirtualTexture&) = delete;
+  VirtualTexture& operator=(const VirtualTexture&) = delete;
+
+  bool isOpen() const { return fd >= 0; }
+
+  int getTileSize() const { return tileSize; }
+  int getTilesX() const { return tilesX; }
+  int getTilesY() const { return tilesY; }
+  std::uint64_t getId() const { return id; }
+
+  // bytes of one tile, in memory and on disk
+  std::size_t tileBytes() const;
+
+  // read a tile from disk into a tileSize x tileSize texture
+  bool readTile(int tile, texture& out) const;
+
+private:
+  int fd;
+  TextureFormat format;
+  int tileSize, tilesX, tilesY;
+  long dataOffset;
+  std::uint64_t id;
+};
+
+struct TileCacheStats {
+  std::uint64_t lookups, hits, misses, evictions, bytesLoaded;
+  std::size_t residentBytes, budget;
+};
+
+// limit the bytes held by resident tiles across all virtual textures
+void setTileCacheBudget(std::size_t bytes);
+TileCacheStats tileCacheStats();
+void resetTileCacheStats();
+
+// the tile, from the cache or faulted in from disk, valid until the
+// calling thread fetches another one
+// returns an empty texture if the tile could not be read
+const texture* fetchTile(const VirtualTexture& vt, int tile);
@@ -0,0 +1,126 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+// Reference consumer of the shared memory frame ring written by
+// main --shm NAME:
+//   shmframes [--frames N] [--timeout SECONDS] [--ppm FILE] NAME
+// Waits for the ring to appear, then reads each new frame in place and
+// prints its number and mean color, until N frames were read, the
+// renderer closes the ring or nothing happens for SECONDS. With --ppm the
+// last frame read is also written out as an image.
+
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "util/image.hh"
+#include "util/sharedFrames.hh"
+
+using namespace std;
+
+namespace {
+
+typedef chrono::steady_clock Clock;
+
+void usage() {
+  cout << "Usage: shmframes [--frames N] [--timeout SECONDS] [--ppm FILE] NAME" << endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+  long frames = 0;
+  double timeout = 10;
+  string ppm, name;
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "--frames" && i + 1 < argc) {
+      frames = atol(argv[++i]);
+    } else if (arg == "--timeout" && i + 1 < argc) {
+      timeout = atof(argv[++i]);
+    } else if (arg == "--ppm" && i + 1 < argc) {
+      ppm = argv[++i];
+    } else if (name.empty()) {
+      name = arg;
+    } else {
+      usage();
+      return -1;
+    }
+  }
+  if (name.empty()) {
+    usage();
+    return -1;
+  }
+
+  auto idle = chrono::duration_cast<Clock::duration>(chrono::duration<double>(timeout));
+  Clock::time_point deadline = Clock::now() + idle;
+  unique_ptr<SharedFrameReader> ring;
+  for (;;) {
+    ring.reset(new SharedFrameReader(name));
+    if (ring->valid())
+      break;
+    if (Clock::now() > deadline) {
+      cout << "Error! " << ring->getError() << endl;
+      return -1;
+    }
+    this_thread::sleep_for(chrono::milliseconds(10));
+  }
+  const SharedFrameHeader& header = ring->getHeader();
+  cout << name << ": " << header.width << "x" << header.height << ", "
+       << header.slots << " slots of " << header.slotBytes << " bytes" << endl;
+
+  size_t pixels = (size_t)header.width * header.height;
+  uint64_t last = 0;
+  long read = 0, missed = 0, torn = 0;
+  bool written = false;
+  deadline = Clock::now() + idle;
+  while (frames == 0 || read < frames) {
+    // read closed first, so a frame finished just before closing is seen
+    bool closed = header.closed.load(memory_order_acquire);
+    SharedFrameReader::Frame frame = ring->latest();
+    if (frame.number == last) {
+      if (closed)
+        break;
+      if (Clock::now() > deadline) {
+        cout << "Error! No frame for " << timeout << " seconds" << endl;
+        return -1;
+      }
+      this_thread::sleep_for(chrono::milliseconds(1));
+      continue;
+    }
+
+    double sum[3] = { 0, 0, 0 };
+    for (size_t i = 0; i < pixels; ++i)
+      for (int c = 0; c < 3; ++c)
+        sum[c] += frame.pixels[i * 3 + c];
+    bool saved = !ppm.empty() && writePPM(ppm, frame.pixels, header.width, header.height);
+    if (!ring->consistent(frame)) {
+      ++torn;
+      continue;
+    }
+    written = saved;
+
+    if (last)
+      missed += frame.number - last - 1;
+    last = frame.number;
+    ++read;
+    deadline = Clock::now() + idle;
+    cout << "Frame " << frame.number << ": mean " << sum[0] / pixels << " "
+         << sum[1] / pixels << " " << sum[2] / pixels << endl;
+  }
+  cout << read << " frames read, " << missed << " missed, " << torn << " torn" << endl;
+  if (!ppm.empty() && !written) {
+    cout << "Error! Could not write " << ppm << endl;
+    return -1;
+  }
+  return 0;
+}
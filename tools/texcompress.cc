@@ -0,0 +1,144 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+// Offline texture compressor. Rewrites a scene so that its textures live in
+// binary texture files of the chosen format next to the new scene file:
+//   texcompress [--format float|rgb8|bc1] [--tile N] in.dat out.dat
+// writes out.dat plus out.0.a5t, out.1.a5t, ...
+// With --tile the texture files are split into N x N tiles that the
+// renderer pages in on demand instead of loading whole.
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "texture/texture.hh"
+#include "util/tokenReader.hh"
+
+using namespace std;
+
+namespace {
+
+const int tokensPerVertex = 8;     // x y z nx ny nz u v
+const int tokensPerTriangleHead = 5; // whichtexture kamb kdiff kspec shininess
+const int tokensPerLight = 6;      // x y z r g b
+
+void copyLine(TokenReader& in, ostream& out, int tokens) {
+  for (int i = 0; i < tokens; ++i)
+    out << (i ? " " : "") << in.nextWord();
+  out << "\n";
+}
+
+string baseName(const string& path) {
+  size_t slash = path.find_last_of('/');
+  return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+string directoryName(const string& path) {
+  size_t slash = path.find_last_of('/');
+  return slash == string::npos ? "" : path.substr(0, slash);
+}
+
+void usage() {
+  cout << "Usage: texcompress [--format float|rgb8|bc1] [--tile N] in.dat out.dat" << endl;
+}
+
+}
+
+int main(int argc, char** argv) {
+  TextureFormat format = TextureFormat::BC1;
+  int tileSize = 0;
+  string input, output;
+  for (int i = 1; i < argc; ++i) {
+    string arg = argv[i];
+    if (arg == "--format" && i + 1 < argc) {
+      if (!parseTextureFormat(argv[++i], format)) {
+        cout << "Error! Unknown texture format " << argv[i] << endl;
+        return -1;
+      }
+    } else if (arg == "--tile" && i + 1 < argc) {
+      tileSize = atoi(argv[++i]);
+      if (tileSize == 0)
+        tileSize = -1;
+    } else if (input.empty()) {
+      input = arg;
+    } else if (output.empty()) {
+      output = arg;
+    } else {
+      usage();
+      return -1;
+    }
+  }
+  if (output.empty()) {
+    usage();
+    return -1;
+  }
+  if (tileSize < 0 || (format == TextureFormat::BC1 && tileSize % 4 != 0)) {
+    cout << "Error! Tile size must be positive, and a multiple of 4 for bc1" << endl;
+    return -1;
+  }
+
+  ifstream infile(input, ios::binary);
+  if (!infile) {
+    cout << "Error! Input file " << input << " does not exist!" << endl;
+    return -1;
+  }
+  string contents((istreambuf_iterator<char>(infile)), istreambuf_iterator<char>());
+  TokenReader in(contents.data(), contents.data() + contents.size());
+  ofstream out(output);
+  int numtriangles = in.nextInt();
+  int numlights = in.nextInt();
+  int numtextures = in.nextInt();
+  out << numtriangles << " " << numlights << " " << numtextures << "\n";
+
+  for (int i = 0; i < numtriangles; ++i) {
+    out << "\n";
+    copyLine(in, out, tokensPerTriangleHead);
+    for (int j = 0; j < 3; ++j)
+      copyLine(in, out, tokensPerVertex);
+  }
+  out << "\n";
+  copyLine(in, out, 3); // ambient light
+  for (int i = 0; i < numlights; ++i)
+    copyLine(in, out, tokensPerLight);
+  if (in.fail) {
+    cout << "Error! Not enough triangles or lights in " << input << endl;
+    return -1;
+  }
+
+  string inputDirectory = directoryName(input);
+  string outputDirectory = directoryName(output);
+  size_t totalBefore = 0, totalAfter = 0;
+  for (int i = 0; i < numtextures; ++i) {
+    texture t;
+    if (!readTexture(in, inputDirectory, t)) {
+      cout << "Error! Could not read texture " << i << " of " << input << endl;
+      return -1;
+    }
+    totalBefore += textureBytes(t);
+    convertTexture(t, format);
+    totalAfter += textureBytes(t);
+
+    string name = baseName(output) + "." + to_string(i) + ".a5t";
+    string path = outputDirectory.empty() ? name : outputDirectory + "/" + name;
+    bool saved = tileSize ? saveTiledTextureFile(path, t, tileSize) : saveTextureFile(path, t);
+    if (!saved) {
+      cout << "Error! Could not write " << path << endl;
+      return -1;
+    }
+    out << name << "\n";
+  }
+  // meshes and instances follow the textures unchanged
+  out.write(in.position, in.end - in.position);
+
+  cout << numtextures << " textures: " << totalBefore << " bytes -> " << totalAfter
+       << " bytes as " << textureFormatName(format) << endl;
+  return out ? 0 : -1;
+}
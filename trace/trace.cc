@@ -0,0 +1,137 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "trace.hh"
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace Trace {
+
+namespace {
+
+struct Event {
+  const char* name;
+  double begin, duration;
+};
+
+// Single producer ring: only the owning thread writes, and it never waits.
+// When full the oldest events are overwritten. Storage is allocated on the
+// first event so naming an idle thread costs nothing.
+struct Ring {
+  static const std::uint64_t capacity = 1 << 16;
+
+  Ring(int tid) : head(0), tid(tid) {}
+
+  std::vector<Event> events;
+  std::atomic<std::uint64_t> head; // total number of events ever recorded
+  int tid;
+  std::string name;
+};
+
+std::atomic<bool> isEnabled(false);
+std::chrono::steady_clock::time_point epoch;
+
+// rings outlive their threads so short lived workers still show up
+std::mutex registryMutex;
+std::vector<std::unique_ptr<Ring>> registry;
+
+Ring& threadRing() {
+  thread_local Ring* ring = nullptr;
+  if (!ring) {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    registry.emplace_back(new Ring((int)registry.size() + 1));
+    ring = registry.back().get();
+    ring->name = "thread " + std::to_string(ring->tid);
+  }
+  return *ring;
+}
+
+// trace names are identifiers, but keep the JSON valid regardless
+void writeEscaped(std::ostream& out, const std::string& text) {
+  out << '"';
+  for (char c : text) {
+    if (c == '"' || c == '\\')
+      out << '\\';
+    if ((unsigned char)c >= 0x20)
+      out << c;
+  }
+  out << '"';
+}
+
+}
+
+void enable() {
+  epoch = std::chrono::steady_clock::now();
+  isEnabled.store(true, std::memory_order_release);
+}
+
+bool enabled() {
+  return isEnabled.load(std::memory_order_relaxed);
+}
+
+double now() {
+  std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - epoch;
+  return elapsed.count();
+}
+
+void setThreadName(const std::string& name) {
+  Ring& ring = threadRing();
+  std::lock_guard<std::mutex> lock(registryMutex);
+  ring.name = name;
+}
+
+void record(const char* name, double begin, double duration) {
+  Ring& ring = threadRing();
+  if (ring.events.empty())
+    ring.events.resize(Ring::capacity);
+  std::uint64_t head = ring.head.load(std::memory_order_relaxed);
+  ring.events[head & (Ring::capacity - 1)] = { name, begin, duration };
+  ring.head.store(head + 1, std::memory_order_release);
+}
+
+bool write(const std::string& path) {
+  std::ofstream out(path);
+  if (!out)
+    return false;
+  std::lock_guard<std::mutex> lock(registryMutex);
+  out << std::fixed << std::setprecision(3);
+  out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  for (auto& ring : registry) {
+    if (!first)
+      out << ",";
+    first = false;
+    out << "\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << ring->tid
+        << ",\"args\":{\"name\":";
+    writeEscaped(out, ring->name);
+    out << "}}";
+    std::uint64_t head = ring->head.load(std::memory_order_acquire);
+    std::uint64_t tail = head > Ring::capacity ? head - Ring::capacity : 0;
+    for (std::uint64_t i = tail; i < head; ++i) {
+      const Event& event = ring->events[i & (Ring::capacity - 1)];
+      out << ",\n{\"ph\":\"X\",\"name\":";
+      writeEscaped(out, event.name);
+      out << ",\"pid\":1,\"tid\":" << ring->tid
+          << ",\"ts\":" << event.begin << ",\"dur\":" << event.duration << "}";
+    }
+    if (tail > 0)
+      out << ",\n{\"ph\":\"i\",\"s\":\"t\",\"name\":\"dropped " << tail
+          << " events\",\"pid\":1,\"tid\":" << ring->tid << ",\"ts\":0}";
+  }
+  out << "\n]}\n";
+  return (bool)out;
+}
+
+}
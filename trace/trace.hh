@@ -0,0 +1,57 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <string>
+
+// Scoped timers recorded per thread and exported as Chrome trace_event
+// JSON (load the file in chrome://tracing or ui.perfetto.dev).
+// Recording costs one branch while tracing is disabled.
+namespace Trace {
+
+void enable();
+bool enabled();
+
+// microseconds since tracing was enabled
+double now();
+
+// name the calling thread in the exported timeline
+void setThreadName(const std::string& name);
+
+// append a complete event to the calling thread's ring buffer
+// name must outlive the trace, string literals are expected
+void record(const char* name, double begin, double duration);
+
+// export every thread's events, call once the recording threads are idle
+// returns false if the file could not be written
+bool write(const std::string& path);
+
+// Times its own lifetime
+class Scope {
+public:
+  explicit Scope(const char* name)
+    : name(name), begin(enabled() ? now() : -1) {}
+  ~Scope() {
+    if (begin >= 0)
+      record(name, begin, now() - begin);
+  }
+
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+
+private:
+  const char* name;
+  double begin;
+};
+
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(name) Trace::Scope TRACE_CONCAT(traceScope, __LINE__)(name)
@@ -0,0 +1,117 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "tweenBatch.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+const float pi = 3.14159265358979f;
+
+template <Easing E>
+inline float curve(float t) {
+  switch (E) {
+  case Easing::QuadIn: return t * t;
+  case Easing::QuadOut: return t * (2 - t);
+  case Easing::QuadInOut: return t < 0.5f ? 2 * t * t : -1 + (4 - 2 * t) * t;
+  case Easing::CubicIn: return t * t * t;
+  case Easing::CubicOut: return (t - 1) * (t - 1) * (t - 1) + 1;
+  case Easing::CubicInOut:
+    return t < 0.5f ? 4 * t * t * t : (t - 1) * (2 * t - 2) * (2 * t - 2) + 1;
+  case Easing::SineInOut: return 0.5f * (1 - std::cos(pi * t));
+  default: return t;
+  }
+}
+
+// one pass over the arrays of a curve; the polynomial curves leave no
+// branches once E is known, so the compiler vectorizes them, while
+// SineInOut calls std::cos per tween
+template <Easing E>
+void step(const float* from, const float* target, float* elapsed, const float* duration,
+          float* current, std::size_t count, float delta) {
+  for (std::size_t i = 0; i < count; ++i) {
+    elapsed[i] += delta;
+    float t = std::min(elapsed[i] / duration[i], 1.0f);
+    current[i] = from[i] + (target[i] - from[i]) * curve<E>(t);
+  }
+}
+
+typedef void (*Step)(const float*, const float*, float*, const float*, float*, std::size_t,
+                     float);
+
+const Step steps[easingCount] = {
+  step<Easing::Linear>,
+  step<Easing::QuadIn>, step<Easing::QuadOut>, step<Easing::QuadInOut>,
+  step<Easing::CubicIn>, step<Easing::CubicOut>, step<Easing::CubicInOut>,
+  step<Easing::SineInOut>
+};
+
+}
+
+void TweenBatch::add(float* value, float target, float duration, Easing easing,
+                     std::function<void()> done) {
+  Lanes& l = lanes[(int)easing];
+  l.from.push_back(*value);
+  l.target.push_back(target);
+  l.elapsed.push_back(0);
+  // a zero duration finishes on the next advance
+  l.duration.push_back(duration > 0 ? duration : std::numeric_limits<float>::min());
+  l.current.push_back(*value);
+  l.values.push_back(value);
+  l.done.push_back(std::move(done));
+}
+
+void TweenBatch::advance(float delta) {
+  std::vector<std::function<void()>> finished;
+  for (int e = 0; e < easingCount; ++e) {
+    Lanes& l = lanes[e];
+    steps[e](l.from.data(), l.target.data(), l.elapsed.data(), l.duration.data(),
+             l.current.data(), l.size(), delta);
+    for (std::size_t i = 0; i < l.size(); ++i)
+      *l.values[i] = l.current[i];
+    for (std::size_t i = l.size(); i-- > 0;) {
+      if (l.elapsed[i] < l.duration[i])
+        continue;
+      *l.values[i] = l.target[i];
+      if (l.done[i])
+        finished.push_back(std::move(l.done[i]));
+      l.remove(i);
+    }
+  }
+  for (auto& done : finished)
+    done();
+}
+
+std::size_t TweenBatch::size() const {
+  std::size_t total = 0;
+  for (const Lanes& l : lanes)
+    total += l.size();
+  return total;
+}
+
+// swaps the last tween into i
+void TweenBatch::Lanes::remove(std::size_t i) {
+  std::size_t last = size() - 1;
+  from[i] = from[last];
+  target[i] = target[last];
+  elapsed[i] = elapsed[last];
+  duration[i] = duration[last];
+  current[i] = current[last];
+  values[i] = values[last];
+  done[i] = std::move(done[last]);
+  from.pop_back();
+  target.pop_back();
+  elapsed.pop_back();
+  duration.pop_back();
+  current.pop_back();
+  values.pop_back();
+  done.pop_back();
+}
@@ -0,0 +1,53 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+enum class Easing {
+  Linear,
+  QuadIn, QuadOut, QuadInOut,
+  CubicIn, CubicOut, CubicInOut,
+  SineInOut
+};
+const int easingCount = 8;
+
+// Many floats tweened at once, advanced by elapsed time rather than per
+// call. Tweens are kept structure-of-arrays, one set of arrays per easing
+// curve, so each advance is one loop per curve over contiguous floats.
+class TweenBatch {
+public:
+  // tweens *value from what it is now to target over duration seconds,
+  // then calls done, if given. value must outlive the tween.
+  void add(float* value, float target, float duration, Easing easing = Easing::Linear,
+           std::function<void()> done = nullptr);
+
+  // moves every tween delta seconds along. Finished tweens land exactly
+  // on their target and are removed before their callbacks run, so
+  // callbacks may add tweens.
+  void advance(float delta);
+
+  std::size_t size() const;
+  bool empty() const { return size() == 0; }
+
+private:
+  struct Lanes {
+    std::vector<float> from, target, elapsed, duration;
+    std::vector<float> current;
+    std::vector<float*> values;
+    std::vector<std::function<void()>> done;
+
+    std::size_t size() const { return values.size(); }
+    void remove(std::size_t i);
+  };
+
+  Lanes lanes[easingCount];
+};
@@ -0,0 +1,65 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <thread>
+
+// Bounded lock-free queue of sequentially numbered items where every
+// consumer sees every item, in order. Any number of producers publish
+// items by number; item i reuses the slot of item i - capacity once all
+// consumers have released that one, and blocks until then.
+template <typename T>
+class BroadcastRing {
+public:
+  BroadcastRing(std::size_t capacity, int consumers)
+    : capacity(capacity), consumers(consumers), slots(new Slot[capacity]) {
+    for (std::size_t i = 0; i < capacity; ++i) {
+      slots[i].published.store(-1, std::memory_order_relaxed);
+      slots[i].writable.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  void publish(long index, T value) {
+    Slot& slot = slots[index % capacity];
+    while (slot.writable.load(std::memory_order_acquire) != index)
+      std::this_thread::yield();
+    slot.value = std::move(value);
+    slot.remaining.store(consumers, std::memory_order_relaxed);
+    slot.published.store(index, std::memory_order_release);
+  }
+
+  // waits for item index; valid until this consumer releases it
+  const T& at(long index) {
+    Slot& slot = slots[index % capacity];
+    while (slot.published.load(std::memory_order_acquire) != index)
+      std::this_thread::yield();
+    return slot.value;
+  }
+
+  void release(long index) {
+    Slot& slot = slots[index % capacity];
+    if (slot.remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      slot.writable.store(index + capacity, std::memory_order_release);
+  }
+
+private:
+  struct Slot {
+    std::atomic<long> published;	// number of the item held
+    std::atomic<long> writable;	// number of the item that may be written next
+    std::atomic<int> remaining;	// consumers yet to release it
+    T value;
+  };
+
+  std::size_t capacity;
+  int consumers;
+  std::unique_ptr<Slot[]> slots;
+};
@@ -0,0 +1,74 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "fileWatcher.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "trace/trace.hh"
+
+namespace {
+
+// how often the thread looks at stopping while nothing happens
+const int idleMs = 200;
+
+}
+
+FileWatcher::FileWatcher(const std::string& path, std::function<void()> changed)
+  : changed(changed), stopping(false)
+{
+  std::size_t slash = path.find_last_of('/');
+  std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+  name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+  fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd >= 0 && inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+    close(fd);
+    fd = -1;
+  }
+  if (fd < 0) {
+    error = "Could not watch " + directory + ": " + strerror(errno);
+    return;
+  }
+  thread = std::thread(&FileWatcher::run, this);
+}
+
+FileWatcher::~FileWatcher() {
+  if (fd < 0)
+    return;
+  stopping = true;
+  thread.join();
+  close(fd);
+}
+
+void FileWatcher::run() {
+  Trace::setThreadName("watch");
+  alignas(inotify_event) char events[4096];
+  bool pending = false;
+  while (!stopping) {
+    pollfd ready = { fd, POLLIN, 0 };
+    // once the file changed, wait for it to settle before reporting
+    if (poll(&ready, 1, pending ? settleMs : idleMs) <= 0) {
+      if (pending)
+        changed();
+      pending = false;
+      continue;
+    }
+    ssize_t length = read(fd, events, sizeof(events));
+    for (char* p = events; length > 0 && p < events + length; ) {
+      inotify_event* event = (inotify_event*)p;
+      if (event->len && name == event->name)
+        pending = true;
+      p += sizeof(inotify_event) + event->len;
+    }
+  }
+}
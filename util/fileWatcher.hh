@@ -0,0 +1,43 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <string>
+#include <thread>
+
+// Calls changed, from a thread of its own, whenever a file is written or
+// replaced. Watches the file's directory through inotify, since editors
+// often save by renaming a new file over the old one. Changes arriving
+// within settleMs of each other are reported once, after the last.
+class FileWatcher {
+public:
+  static const int settleMs = 50;
+
+  FileWatcher(const std::string& path, std::function<void()> changed);
+  ~FileWatcher();
+
+  FileWatcher(const FileWatcher&) = delete;
+  FileWatcher& operator=(const FileWatcher&) = delete;
+
+  // false with error set when inotify could not watch the directory
+  bool valid() const { return fd >= 0; }
+  const std::string& getError() const { return error; }
+
+private:
+  std::string name;	// of the file within its directory
+  std::function<void()> changed;
+  std::string error;
+  int fd = -1;
+  std::atomic<bool> stopping;
+  std::thread thread;
+
+  void run();
+};
@@ -0,0 +1,68 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "frameStats.hh"
+
+#include <algorithm>
+#include <iomanip>
+
+void FrameStats::record(double ms) {
+  std::lock_guard<std::mutex> lock(mutex);
+  times.push_back(ms);
+}
+
+void FrameStats::drop() {
+  std::lock_guard<std::mutex> lock(mutex);
+  ++dropped;
+}
+
+double FrameStats::percentile(double p) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return percentileLocked(p);
+}
+
+double FrameStats::percentileLocked(double p) const {
+  if (times.empty())
+    return 0;
+  std::vector<double> sorted = times;
+  std::size_t rank = std::min(sorted.size() - 1, (std::size_t)(p / 100 * sorted.size()));
+  std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+  return sorted[rank];
+}
+
+void FrameStats::report(std::ostream& out) const {
+  std::lock_guard<std::mutex> lock(mutex);
+  long missed = std::count_if(times.begin(), times.end(),
+                              [this](double ms) { return ms > budget; });
+  std::streamsize precision = out.precision();
+  out << std::fixed << std::setprecision(1)
+      << "Frames: " << times.size() << ", p50 " << percentileLocked(50)
+      << " ms, p95 " << percentileLocked(95) << " ms, p99 " << percentileLocked(99)
+      << " ms; " << missed << " missed the " << budget << " ms budget, "
+      << dropped << " dropped" << std::endl;
+
+  // quarters of the budget up to twice it, then everything slower
+  const int buckets = 9;
+  long counts[buckets] = {};
+  for (double ms : times)
+    ++counts[std::min(buckets - 1, (int)(ms / (budget / 4)))];
+  out << "  ";
+  for (int i = 0; i < buckets; ++i) {
+    if (i + 1 < buckets)
+      out << "<" << (i + 1) * budget / 4 << ": " << counts[i] << "  ";
+    else
+      out << ">=" << i * budget / 4 << ": " << counts[i];
+  }
+  out << std::defaultfloat << std::setprecision(precision) << std::endl;
+}
+
+void FrameStats::reset() {
+  std::lock_guard<std::mutex> lock(mutex);
+  times.clear();
+  dropped = 0;
+}
@@ -0,0 +1,43 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+// Frame times of an animation loop measured against its per frame budget.
+// Safe to use from the render and GLUT threads at once.
+class FrameStats {
+public:
+  explicit FrameStats(double budgetMs) : budget(budgetMs), dropped(0) {}
+
+  double getBudget() const { return budget; }
+
+  // a finished frame that took ms to render
+  void record(double ms);
+  // a frame never started because the previous one was still rendering
+  void drop();
+
+  // frame time under which p percent of the frames finished
+  double percentile(double p) const;
+
+  // prints the percentiles, deadline misses and a histogram of the frame
+  // times since the last reset
+  void report(std::ostream& out) const;
+  void reset();
+
+private:
+  double budget;
+  std::vector<double> times;
+  long dropped;
+  mutable std::mutex mutex;
+
+  double percentileLocked(double p) const;
+};
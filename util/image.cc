@@ -0,0 +1,29 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "image.hh"
+
+#include <fstream>
+#include <vector>
+
+#include "clamp.hh"
+
+bool writePPM(const std::string& path, const float* rgb, int width, int height) {
+  std::ofstream out(path, std::ios::binary);
+  if (!out)
+    return false;
+  out << "P6\n" << width << " " << height << "\n255\n";
+  std::vector<unsigned char> row(width * 3);
+  for (int y = height - 1; y >= 0; --y) {
+    const float* source = rgb + y * width * 3;
+    for (int i = 0; i < width * 3; ++i)
+      row[i] = (unsigned char)(clamp(0, 1, source[i]) * 255 + 0.5f);
+    out.write((const char*)row.data(), row.size());
+  }
+  return (bool)out;
+}
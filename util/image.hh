@@ -0,0 +1,16 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <string>
+
+// Write width * height float rgb pixels as a binary PPM. Rows are stored
+// bottom to top like the framebuffer and flipped on the way out.
+// returns false if the file could not be written
+bool writePPM(const std::string& path, const float* rgb, int width, int height);
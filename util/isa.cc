@@ -0,0 +1,71 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "isa.hh"
+
+namespace {
+
+Isa active = Isa::Baseline;
+
+}
+
+bool parseIsa(const std::string& name, Isa& isa, bool& automatic) {
+  automatic = false;
+  if (name == "auto")
+    automatic = true;
+  else if (name == "baseline")
+    isa = Isa::Baseline;
+  else if (name == "sse4.2")
+    isa = Isa::SSE42;
+  else if (name == "avx2")
+    isa = Isa::AVX2;
+  else if (name == "avx512")
+    isa = Isa::AVX512;
+  else
+    return false;
+  return true;
+}
+
+const char* isaName(Isa isa) {
+  switch (isa) {
+  case Isa::SSE42: return "sse4.2";
+  case Isa::AVX2: return "avx2";
+  case Isa::AVX512: return "avx512";
+  default: return "baseline";
+  }
+}
+
+bool isaSupported(Isa isa) {
+#if A5_ISA_VARIANTS
+  __builtin_cpu_init();
+  switch (isa) {
+  case Isa::SSE42: return __builtin_cpu_supports("sse4.2");
+  case Isa::AVX2: return __builtin_cpu_supports("avx2");
+  case Isa::AVX512: return __builtin_cpu_supports("avx512f");
+  default: return true;
+  }
+#else
+  return isa == Isa::Baseline;
+#endif
+}
+
+Isa detectIsa() {
+  for (Isa isa : { Isa::AVX512, Isa::AVX2, Isa::SSE42 }) {
+    if (isaSupported(isa))
+      return isa;
+  }
+  return Isa::Baseline;
+}
+
+void selectIsa(Isa isa) {
+  active = isa;
+}
+
+Isa activeIsa() {
+  return active;
+}
@@ -0,0 +1,38 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <string>
+
+// Instruction sets the hot kernels are compiled for. The binary is built
+// for the baseline and picks the best variant the CPU supports at
+// startup. Off x86 only the baseline exists.
+enum class Isa { Baseline, SSE42, AVX2, AVX512 };
+
+// "auto" leaves the choice to detectIsa
+bool parseIsa(const std::string& name, Isa& isa, bool& automatic);
+const char* isaName(Isa isa);
+
+bool isaSupported(Isa isa);
+// best instruction set this CPU runs
+Isa detectIsa();
+
+// variant every kernel picked from now on uses
+void selectIsa(Isa isa);
+Isa activeIsa();
+
+// target attribute of each variant
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define A5_ISA_VARIANTS 1
+#define A5_TARGET_SSE42 __attribute__((target("sse4.2")))
+#define A5_TARGET_AVX2 __attribute__((target("avx2")))
+#define A5_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define A5_ISA_VARIANTS 0
+#endif
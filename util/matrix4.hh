@@ -0,0 +1,105 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cmath>
+
+#include "util/vector3.hh"
+
+// Row-major 4x4 matrix acting on column vectors
+struct Matrix4 {
+  float m[4][4];
+
+  static Matrix4 identity() {
+    return { { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 }, { 0, 0, 0, 1 } } };
+  }
+};
+
+inline Matrix4 operator*(const Matrix4& lhs, const Matrix4& rhs) {
+  Matrix4 result;
+  for (int i = 0; i < 4; ++i) {
+    for (int j = 0; j < 4; ++j) {
+      result.m[i][j] = 0;
+      for (int k = 0; k < 4; ++k)
+        result.m[i][j] += lhs.m[i][k] * rhs.m[k][j];
+    }
+  }
+  return result;
+}
+
+inline Matrix4 translation(Vector3 offset) {
+  Matrix4 result = Matrix4::identity();
+  result.m[0][3] = offset.x;
+  result.m[1][3] = offset.y;
+  result.m[2][3] = offset.z;
+  return result;
+}
+
+inline Matrix4 scaling(Vector3 scale) {
+  Matrix4 result = Matrix4::identity();
+  result.m[0][0] = scale.x;
+  result.m[1][1] = scale.y;
+  result.m[2][2] = scale.z;
+  return result;
+}
+
+// degrees about the y axis
+inline Matrix4 rotationY(float degrees) {
+  float radians = degrees * 3.14159265f / 180;
+  float c = std::cos(radians), s = std::sin(radians);
+  Matrix4 result = Matrix4::identity();
+  result.m[0][0] = c;
+  result.m[0][2] = s;
+  result.m[2][0] = -s;
+  result.m[2][2] = c;
+  return result;
+}
+
+// camera at eye looking at target, looking down -z in view space
+inline Matrix4 lookAt(Vector3 eye, Vector3 target, Vector3 up) {
+  Vector3 forward = normalize(target - eye);
+  Vector3 side = normalize(cross(forward, up));
+  Vector3 trueUp = cross(side, forward);
+  Matrix4 result = { { { side.x, side.y, side.z, -dot(side, eye) },
+                       { trueUp.x, trueUp.y, trueUp.z, -dot(trueUp, eye) },
+                       { -forward.x, -forward.y, -forward.z, dot(forward, eye) },
+                       { 0, 0, 0, 1 } } };
+  return result;
+}
+
+// OpenGL style projection into clip space, vertical field of view in
+// degrees
+inline Matrix4 perspective(float fov, float aspect, float near, float far) {
+  float f = 1 / std::tan(fov * 3.14159265f / 360);
+  Matrix4 result = { { { f / aspect, 0, 0, 0 },
+                       { 0, f, 0, 0 },
+                       { 0, 0, (far + near) / (near - far), 2 * far * near / (near - far) },
+                       { 0, 0, -1, 0 } } };
+  return result;
+}
+
+// inverse transpose of the upper 3x3, which carries normals
+inline Matrix4 normalMatrix(const Matrix4& matrix) {
+  const float (*a)[4] = matrix.m;
+  float cofactor[3][3] = {
+    { a[1][1] * a[2][2] - a[1][2] * a[2][1], a[1][2] * a[2][0] - a[1][0] * a[2][2],
+      a[1][0] * a[2][1] - a[1][1] * a[2][0] },
+    { a[0][2] * a[2][1] - a[0][1] * a[2][2], a[0][0] * a[2][2] - a[0][2] * a[2][0],
+      a[0][1] * a[2][0] - a[0][0] * a[2][1] },
+    { a[0][1] * a[1][2] - a[0][2] * a[1][1], a[0][2] * a[1][0] - a[0][0] * a[1][2],
+      a[0][0] * a[1][1] - a[0][1] * a[1][0] }
+  };
+  float determinant = a[0][0] * cofactor[0][0] + a[0][1] * cofactor[0][1] + a[0][2] * cofactor[0][2];
+  Matrix4 result = Matrix4::identity();
+  for (int i = 0; i < 3; ++i) {
+    for (int j = 0; j < 3; ++j)
+      result.m[i][j] = determinant != 0 ? cofactor[i][j] / determinant : 0;
+  }
+  return result;
+}
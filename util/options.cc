@@ -0,0 +1,216 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "options.hh"
+#include "parse.hh"
+#include "sharedFrames.hh"
+
+#include <cstdlib>
+#include <iostream>
+
+namespace {
+
+void usage(const char* program) {
+  std::cout << "Usage: " << program << " [options] [scene.dat]" << std::endl
+            << "  --headless FILE.ppm   render one frame to FILE.ppm and exit" << std::endl
+            << "  --shm NAME            headless: publish frames to shared memory NAME" << std::endl
+            << "  --shm-slots N         frames in the shared memory ring (default: 3)" << std::endl
+            << "  --video FILE          headless: stream frames to FILE, - for stdout" << std::endl
+            << "  --video-format F      y4m (default) or raw rgb" << std::endl
+            << "  --debug-view VIEW     none, overdraw, shading, zreject or lighting" << std::endl
+            << "  --msaa N              anti-alias with 2, 4 or 8 samples per pixel" << std::endl
+            << "  --adaptive-shading T  shade smooth triangles at 2x2 or 4x4 within error T" << std::endl
+            << "  --depth-format F      store depth as float32, fixed24 or fixed16" << std::endl
+            << "  --texture-format F    keep inline textures as float, rgb8 or bc1" << std::endl
+            << "  --texture-report      print texture memory and tile cache statistics" << std::endl
+            << "  --tile-cache-mb N     budget for resident virtual texture tiles" << std::endl
+            << "  --load-threads N      threads loading the scene (default: all)" << std::endl
+            << "  --raster-threads N    rasterize bands of rows on N threads (default: off)" << std::endl
+            << "  --setup-threads N     triangle setup threads feeding them (default: 2)" << std::endl
+            << "  --triangle-threads N  rasterize whole triangles on N threads (default: off)" << std::endl
+            << "  --span-buffer         resolve visibility per span instead of per pixel" << std::endl
+            << "  --span-report         print span buffer statistics after every frame" << std::endl
+            << "  --micro-triangles N   rasterize triangles up to N pixels across directly" << std::endl
+            << "  --frame-buffers N     double (2) or triple (3) buffer the window" << std::endl
+            << "  --camera X,Y,Z        view the scene in perspective from X,Y,Z" << std::endl
+            << "  --look-at X,Y,Z       point the camera at X,Y,Z (default: scene center)" << std::endl
+            << "  --fov DEGREES         vertical field of view of the camera (default: 60)" << std::endl
+            << "  --model-yaw DEGREES   turn the scene about its center" << std::endl
+            << "  --turntable SECONDS   keep turning the scene, once every SECONDS" << std::endl
+            << "  --views FILE          render every camera listed in FILE and exit" << std::endl
+            << "  --fps N               target frame rate of animation (default: 30)" << std::endl
+            << "  --frames N            headless: render N animation frames" << std::endl
+            << "  --animate-lights      sweep the lights across the scene" << std::endl
+            << "  --degrade             coarsen shading while frames miss their budget" << std::endl
+            << "  --watch               reload the scene file whenever it changes" << std::endl
+            << "  --progressive N       preview at 1/N resolution (2 or 4) while input goes on" << std::endl
+            << "  --isa ISA             kernels for auto, baseline, sse4.2, avx2 or avx512" << std::endl
+            << "  --trace FILE.json     record a Chrome trace_event timeline" << std::endl;
+}
+
+void fail(const char* program, const std::string& message) {
+  std::cout << "Error! " << message << std::endl;
+  usage(program);
+  exit(-1);
+}
+
+}
+
+Options parseOptions(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    std::string arg = argv[i];
+    if (arg.compare(0, 2, "--") != 0) {
+      options.sourcefile = arg;
+      continue;
+    }
+    if (arg == "--help") {
+      usage(argv[0]);
+      exit(0);
+    }
+    if (arg == "--texture-report") {
+      options.textureReport = true;
+      continue;
+    }
+    if (arg == "--animate-lights") {
+      options.animateLights = true;
+      continue;
+    }
+    if (arg == "--degrade") {
+      options.degrade = true;
+      continue;
+    }
+    if (arg == "--watch") {
+      options.watch = true;
+      continue;
+    }
+    if (arg == "--span-buffer") {
+      options.spanBuffer = true;
+      continue;
+    }
+    if (arg == "--span-report") {
+      options.spanReport = true;
+      continue;
+    }
+    if (i + 1 >= argc)
+      fail(argv[0], "Missing value for " + arg);
+    std::string value = argv[++i];
+    if (arg == "--headless") {
+      options.headless = value;
+    } else if (arg == "--shm") {
+      options.shm = value;
+    } else if (arg == "--video") {
+      options.video = value;
+    } else if (arg == "--video-format") {
+      if (!parseVideoFormat(value, options.videoFormat))
+        fail(argv[0], "Unknown video format " + value);
+    } else if (arg == "--shm-slots") {
+      options.shmSlots = atoi(value.c_str());
+      if (options.shmSlots < 2 || options.shmSlots > sharedFrameMaxSlots)
+        fail(argv[0], "Shared memory slots must be between 2 and " +
+                      std::to_string(sharedFrameMaxSlots));
+    } else if (arg == "--debug-view") {
+      if (!parseDebugView(value, options.debugView))
+        fail(argv[0], "Unknown debug view " + value);
+    } else if (arg == "--msaa") {
+      options.msaa = atoi(value.c_str());
+      if (options.msaa != 1 && options.msaa != 2 && options.msaa != 4 && options.msaa != 8)
+        fail(argv[0], "MSAA takes 1, 2, 4 or 8 samples");
+    } else if (arg == "--adaptive-shading") {
+      options.shadingThreshold = atof(value.c_str());
+      if (options.shadingThreshold < 0)
+        fail(argv[0], "Adaptive shading threshold must not be negative");
+    } else if (arg == "--depth-format") {
+      if (!parseDepthFormat(value, options.depthFormat))
+        fail(argv[0], "Unknown depth format " + value);
+    } else if (arg == "--texture-format") {
+      if (!parseTextureFormat(value, options.textureFormat))
+        fail(argv[0], "Unknown texture format " + value);
+    } else if (arg == "--tile-cache-mb") {
+      int megabytes = atoi(value.c_str());
+      if (megabytes <= 0)
+        fail(argv[0], "Tile cache budget must be positive");
+      options.tileCacheBytes = (std::size_t)megabytes << 20;
+    } else if (arg == "--load-threads") {
+      int threads = atoi(value.c_str());
+      if (threads < 1)
+        fail(argv[0], "Load threads must be at least 1");
+      options.loadThreads = threads;
+    } else if (arg == "--raster-threads") {
+      options.rasterThreads = atoi(value.c_str());
+      if (options.rasterThreads < 0)
+        fail(argv[0], "Raster threads must not be negative");
+    } else if (arg == "--setup-threads") {
+      options.setupThreads = atoi(value.c_str());
+      if (options.setupThreads < 1)
+        fail(argv[0], "Setup threads must be at least 1");
+    } else if (arg == "--triangle-threads") {
+      options.triangleThreads = atoi(value.c_str());
+      if (options.triangleThreads < 0)
+        fail(argv[0], "Triangle threads must not be negative");
+    } else if (arg == "--micro-triangles") {
+      options.microTriangles = atoi(value.c_str());
+      if (options.microTriangles < 0)
+        fail(argv[0], "Micro triangle size must not be negative");
+    } else if (arg == "--progressive") {
+      options.progressive = atoi(value.c_str());
+      if (options.progressive != 2 && options.progressive != 4)
+        fail(argv[0], "Progressive previews take a scale of 2 or 4");
+    } else if (arg == "--frame-buffers") {
+      options.frameBuffers = atoi(value.c_str());
+      if (options.frameBuffers != 2 && options.frameBuffers != 3)
+        fail(argv[0], "Frame buffers must be 2 or 3");
+    } else if (arg == "--camera") {
+      options.camera = true;
+      if (!parseVector3(value, options.cameraEye))
+        fail(argv[0], "Camera position must be X,Y,Z");
+    } else if (arg == "--look-at") {
+      options.lookAtSet = true;
+      if (!parseVector3(value, options.lookAt))
+        fail(argv[0], "Camera target must be X,Y,Z");
+    } else if (arg == "--fov") {
+      options.fov = atof(value.c_str());
+      if (options.fov <= 0 || options.fov >= 180)
+        fail(argv[0], "Field of view must be between 0 and 180 degrees");
+    } else if (arg == "--model-yaw") {
+      options.modelYaw = atof(value.c_str());
+    } else if (arg == "--views") {
+      options.views = value;
+    } else if (arg == "--turntable") {
+      options.turntable = atof(value.c_str());
+      if (options.turntable <= 0)
+        fail(argv[0], "Turntable period must be positive");
+    } else if (arg == "--fps") {
+      options.fps = atof(value.c_str());
+      if (options.fps <= 0)
+        fail(argv[0], "Frame rate must be positive");
+    } else if (arg == "--frames") {
+      options.frames = atoi(value.c_str());
+      if (options.frames < 1)
+        fail(argv[0], "Frames must be at least 1");
+    } else if (arg == "--isa") {
+      if (!parseIsa(value, options.isa, options.isaAuto))
+        fail(argv[0], "Unknown instruction set " + value);
+    } else if (arg == "--trace") {
+      options.trace = value;
+    } else {
+      fail(argv[0], "Unknown option " + arg);
+    }
+  }
+  // the parallel modes only run the specialized span kernels
+  bool parallel = options.rasterThreads > 0 || options.triangleThreads > 0 || options.spanBuffer;
+  if (parallel && (options.msaa > 1 || options.shadingThreshold > 0 ||
+                   options.debugView != DebugView::None))
+    fail(argv[0], "--raster-threads, --triangle-threads and --span-buffer cannot be "
+                  "combined with --msaa, --adaptive-shading or --debug-view");
+  // the parallel modes rasterize without the micro triangle path
+  if (options.microTriangles > 0 && parallel)
+    fail(argv[0], "--micro-triangles cannot be combined with --raster-threads, "
+                  "--triangle-threads or --span-buffer");
+  return options;
+}
@@ -0,0 +1,88 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cstddef>
+#include <string>
+
+#include "debug/debugView.hh"
+#include "scan/depthBuffer.hh"
+#include "texture/texture.hh"
+#include "util/isa.hh"
+#include "util/vector3.hh"
+#include "util/videoSink.hh"
+
+// Command line settings
+//   main [options] [scene.dat]
+struct Options {
+  std::string sourcefile = "triangle.dat";
+  // render once into this PPM instead of opening a window
+  std::string headless;
+  // shared memory frame ring, with its number of slots
+  std::string shm;
+  int shmSlots = 3;
+  // stream of every frame rendered headless, "-" for stdout
+  std::string video;
+  VideoFormat videoFormat = VideoFormat::Y4M;
+  DebugView debugView = DebugView::None;
+  // samples per pixel: 1, 2, 4 or 8
+  int msaa = 1;
+  // shade smooth triangles on a coarser grid while the estimated color
+  // error stays under this, 0 shades every pixel
+  float shadingThreshold = 0;
+  DepthFormat depthFormat = DepthFormat::Float32;
+  // format inline scene textures are converted to on load
+  TextureFormat textureFormat = TextureFormat::Float;
+  bool textureReport = false;
+  // memory for resident tiles of virtual textures
+  std::size_t tileCacheBytes = 256 << 20;
+  // workers loading the scene, 0 for one per hardware thread
+  unsigned loadThreads = 0;
+  // sort-middle pipeline stages, used when rasterThreads > 0
+  int setupThreads = 2;
+  int rasterThreads = 0;
+  // threads taking whole triangles, 0 for off
+  int triangleThreads = 0;
+  // span buffer hidden surface removal instead of the depth buffer
+  bool spanBuffer = false;
+  bool spanReport = false;
+  // bounding box size up to which triangles skip the edge tables, 0 for off
+  int microTriangles = 0;
+  // render targets cycled by the render thread: 2 or 3
+  int frameBuffers = 3;
+  // view the scene, taken as world space, from a camera at cameraEye
+  bool camera = false;
+  Vector3 cameraEye = { 0, 0, 0 };
+  bool lookAtSet = false;	// otherwise the camera looks at the scene's center
+  Vector3 lookAt = { 0, 0, 0 };
+  float fov = 60;
+  float modelYaw = 0;
+  float turntable = 0;	// seconds per turn of the model, 0 for still
+  // file listing cameras rendered headless, each to its own image
+  std::string views;
+  // animation frame loop: its target rate, frames rendered headless, and
+  // whether shading coarsens while frames miss their budget
+  float fps = 30;
+  int frames = 1;
+  bool animateLights = false;
+  bool degrade = false;
+  // reload the scene file in the window whenever it changes
+  bool watch = false;
+  // render at 1/progressive resolution while input goes on, then in
+  // full once it settles; 0 for always in full
+  int progressive = 0;
+  // instruction set of the hot kernels, picked at startup when automatic
+  Isa isa = Isa::Baseline;
+  bool isaAuto = true;
+  // write a Chrome trace_event timeline here on exit
+  std::string trace;
+};
+
+// exits with a usage message on bad input
+Options parseOptions(int argc, char** argv);
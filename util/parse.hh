@@ -0,0 +1,20 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cstdio>
+#include <string>
+
+#include "util/vector3.hh"
+
+// reads "x,y,z"
+inline bool parseVector3(const std::string& text, Vector3& vector) {
+  char end;
+  return sscanf(text.c_str(), "%f,%f,%f%c", &vector.x, &vector.y, &vector.z, &end) == 3;
+}
@@ -0,0 +1,86 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "renderThread.hh"
+
+#include <algorithm>
+
+#include "trace/trace.hh"
+
+RenderThread::RenderThread(int width, int height, int count, RenderFunction render)
+  : buffers(count, std::vector<float>(width * height * 3, 0.0f)),
+    front(buffers[0].data()), back(buffers[1].data()),
+    ready(count > 2 ? buffers[2].data() : nullptr),
+    fresh(false), rendering(false), requested(0), stopping(false), render(render) {
+  thread = std::thread(&RenderThread::run, this);
+}
+
+RenderThread::~RenderThread() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+    ++requested;
+  }
+  wake.notify_all();
+  thread.join();
+}
+
+void RenderThread::request() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    ++requested;
+  }
+  wake.notify_all();
+}
+
+const float* RenderThread::latest() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fresh) {
+      std::swap(front, ready ? ready : back);
+      fresh = false;
+    }
+  }
+  wake.notify_all();
+  return front;
+}
+
+void RenderThread::run() {
+  Trace::setThreadName("render");
+  unsigned rendered = 0;
+  for (;;) {
+    unsigned generation;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [&]() { return stopping || requested != rendered; });
+      if (stopping)
+        return;
+      generation = requested;
+      rendering = true;
+    }
+    auto stale = [&]() { return requested != generation; };
+    if (render(back, stale)) {
+      rendered = generation;
+      publish();
+    }
+    rendering = false;
+  }
+}
+
+// hands the finished back buffer to the presenter
+void RenderThread::publish() {
+  std::unique_lock<std::mutex> lock(mutex);
+  if (ready) {
+    std::swap(back, ready);
+    fresh = true;
+    return;
+  }
+  // double buffered: back becomes the front once presented
+  fresh = true;
+  wake.wait(lock, [this]() { return stopping || !fresh; });
+}
@@ -0,0 +1,65 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Renders frames on its own thread into double or triple buffered rgb
+// targets, so the thread presenting them never waits on a frame.
+//
+// With three buffers the renderer finishes into a spare buffer and moves
+// on; with two it waits after each frame until the presenter picks it up.
+// Requesting a frame makes the one in progress stale, and the render
+// function is expected to give up on it early.
+class RenderThread {
+public:
+  // draws a frame into target, returning false when it gave up because
+  // stale() turned true
+  typedef std::function<bool(float* target, const std::function<bool()>& stale)> RenderFunction;
+
+  RenderThread(int width, int height, int buffers, RenderFunction render);
+  // abandons the frame in progress and joins the thread
+  ~RenderThread();
+
+  RenderThread(const RenderThread&) = delete;
+  RenderThread& operator=(const RenderThread&) = delete;
+
+  // asks for a new frame, cancelling the one in progress
+  void request();
+
+  // presenter side: whether a frame finished since the last latest(),
+  // and the most recent finished frame
+  bool hasNewFrame() const { return fresh; }
+  const float* latest();
+
+  // whether a frame is being rendered or waits to be requested
+  bool busy() const { return rendering; }
+
+private:
+  std::vector<std::vector<float>> buffers;
+  float* front;		// being presented
+  float* back;		// being rendered
+  float* ready;		// finished, waiting to be presented; null when double buffered
+  std::atomic<bool> fresh;
+  std::atomic<bool> rendering;
+  std::atomic<unsigned> requested;
+  bool stopping;
+  std::mutex mutex;
+  std::condition_variable wake;
+  RenderFunction render;
+  std::thread thread;
+
+  void run();
+  void publish();
+};
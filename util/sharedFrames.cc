@@ -0,0 +1,170 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "sharedFrames.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const std::size_t pageBytes = 4096;
+
+std::size_t roundUp(std::size_t bytes) {
+  return (bytes + pageBytes - 1) / pageBytes * pageBytes;
+}
+
+// shm_open wants a leading slash
+std::string objectName(const std::string& name) {
+  return name[0] == '/' ? name : "/" + name;
+}
+
+std::string failure(const std::string& what, const std::string& name) {
+  return what + " " + name + ": " + strerror(errno);
+}
+
+}
+
+SharedFrameWriter::SharedFrameWriter(const std::string& name, int width, int height, int slots)
+  : name(objectName(name))
+{
+  std::size_t slotBytes = roundUp((std::size_t)width * height * 3 * sizeof(float));
+  std::size_t firstSlot = roundUp(sizeof(SharedFrameHeader));
+  bytes = firstSlot + slots * slotBytes;
+
+  shm_unlink(this->name.c_str());
+  int fd = shm_open(this->name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+  if (fd < 0) {
+    error = failure("Could not create", this->name);
+    return;
+  }
+  if (ftruncate(fd, bytes) != 0) {
+    error = failure("Could not size", this->name);
+    ::close(fd);
+    shm_unlink(this->name.c_str());
+    return;
+  }
+  void* mapping = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    error = failure("Could not map", this->name);
+    shm_unlink(this->name.c_str());
+    return;
+  }
+
+  // the object starts out zeroed, so the atomics already hold 0
+  base = (unsigned char*)mapping;
+  header = (SharedFrameHeader*)mapping;
+  header->version = sharedFrameVersion;
+  header->width = width;
+  header->height = height;
+  header->format = SharedFrameFormat::RgbFloat32;
+  header->slots = slots;
+  header->slotBytes = slotBytes;
+  header->firstSlot = firstSlot;
+  // readers take the header as complete once the magic is there
+  header->magic.store(sharedFrameMagic, std::memory_order_release);
+}
+
+SharedFrameWriter::~SharedFrameWriter() {
+  if (!header)
+    return;
+  close();
+  munmap(base, bytes);
+  shm_unlink(name.c_str());
+}
+
+float* SharedFrameWriter::begin() {
+  frame = header->published.load(std::memory_order_relaxed) + 1;
+  std::size_t index = (frame - 1) % header->slots;
+  SharedFrameSlot& slot = header->slot[index];
+  std::uint64_t sequence = slot.sequence.load(std::memory_order_relaxed);
+  slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.frame.store(frame, std::memory_order_relaxed);
+  return (float*)(base + header->firstSlot + index * header->slotBytes);
+}
+
+void SharedFrameWriter::commit() {
+  SharedFrameSlot& slot = header->slot[(frame - 1) % header->slots];
+  slot.sequence.store(slot.sequence.load(std::memory_order_relaxed) + 1,
+                      std::memory_order_release);
+  header->published.store(frame, std::memory_order_release);
+}
+
+void SharedFrameWriter::close() {
+  header->closed.store(1, std::memory_order_release);
+}
+
+SharedFrameReader::SharedFrameReader(const std::string& name) {
+  std::string object = objectName(name);
+  int fd = shm_open(object.c_str(), O_RDONLY, 0);
+  if (fd < 0) {
+    error = failure("Could not open", object);
+    return;
+  }
+  struct stat status;
+  if (fstat(fd, &status) != 0 || (std::size_t)status.st_size < sizeof(SharedFrameHeader)) {
+    error = object + " is not a frame ring";
+    ::close(fd);
+    return;
+  }
+  bytes = status.st_size;
+  void* mapping = mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    error = failure("Could not map", object);
+    return;
+  }
+  base = (const unsigned char*)mapping;
+  const SharedFrameHeader* mapped = (const SharedFrameHeader*)mapping;
+  if (mapped->magic.load(std::memory_order_acquire) != sharedFrameMagic ||
+      mapped->version != sharedFrameVersion ||
+      mapped->slots < 1 || mapped->slots > (std::uint32_t)sharedFrameMaxSlots ||
+      mapped->firstSlot + mapped->slots * mapped->slotBytes > bytes) {
+    error = object + " is not a frame ring of version " + std::to_string(sharedFrameVersion);
+    munmap((void*)base, bytes);
+    return;
+  }
+  header = mapped;
+}
+
+SharedFrameReader::~SharedFrameReader() {
+  if (header)
+    munmap((void*)base, bytes);
+}
+
+SharedFrameReader::Frame SharedFrameReader::latest() const {
+  Frame result;
+  for (;;) {
+    std::uint64_t number = header->published.load(std::memory_order_acquire);
+    if (number == 0)
+      return result;
+    std::size_t index = (number - 1) % header->slots;
+    const SharedFrameSlot& slot = header->slot[index];
+    std::uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    // a slot being rewritten, or already holding a newer frame, means the
+    // writer moved on; look again
+    if (sequence & 1 || slot.frame.load(std::memory_order_relaxed) != number)
+      continue;
+    result.number = number;
+    result.sequence = sequence;
+    result.slot = &slot;
+    result.pixels = (const float*)(base + header->firstSlot + index * header->slotBytes);
+    return result;
+  }
+}
+
+bool SharedFrameReader::consistent(const Frame& frame) const {
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return frame.slot->sequence.load(std::memory_order_relaxed) == frame.sequence;
+}
@@ -0,0 +1,116 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// A ring of frames in POSIX shared memory, /dev/shm/NAME, that other local
+// processes map and read in place. The renderer draws straight into a
+// slot, so frames are never copied on either side.
+//
+// The object starts with a SharedFrameHeader followed by the slots, each
+// slotBytes long and page aligned. Frame n (counting from 1) goes to slot
+// (n - 1) % slots. Each slot carries a sequence lock: its sequence is odd
+// while the slot is written, and a reader that sees the same even
+// sequence before and after using the pixels knows they were not torn.
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2, "shared frames need lock free 64-bit atomics");
+
+const std::uint32_t sharedFrameMagic = 0x52463541;	// "A5FR"
+const std::uint32_t sharedFrameVersion = 1;
+const int sharedFrameMaxSlots = 8;
+
+enum class SharedFrameFormat : std::uint32_t {
+  RgbFloat32 = 1,	// 3 floats in [0, 1] per pixel, rows bottom to top
+};
+
+struct SharedFrameSlot {
+  std::atomic<std::uint64_t> sequence;
+  std::atomic<std::uint64_t> frame;	// number of the frame in the slot, 0 for none
+};
+
+struct SharedFrameHeader {
+  std::atomic<std::uint32_t> magic;
+  std::uint32_t version;
+  std::uint32_t width, height;
+  SharedFrameFormat format;
+  std::uint32_t slots;
+  std::uint64_t slotBytes;
+  std::uint64_t firstSlot;	// offset of slot 0 from the start of the object
+  std::atomic<std::uint64_t> published;	// frames finished so far
+  std::atomic<std::uint32_t> closed;	// the renderer is done
+  SharedFrameSlot slot[sharedFrameMaxSlots];
+};
+
+// Renderer side. Creates the object, replacing a stale one of the same
+// name, and removes its name again when destroyed; mappings in readers
+// stay valid.
+class SharedFrameWriter {
+public:
+  SharedFrameWriter(const std::string& name, int width, int height, int slots);
+  ~SharedFrameWriter();
+
+  SharedFrameWriter(const SharedFrameWriter&) = delete;
+  SharedFrameWriter& operator=(const SharedFrameWriter&) = delete;
+
+  // false with error set when the object could not be created
+  bool valid() const { return header; }
+  const std::string& getError() const { return error; }
+
+  // locks the next slot and returns its pixels to render into
+  float* begin();
+  // unlocks the slot and makes it the latest frame
+  void commit();
+  // tells readers no more frames follow
+  void close();
+
+private:
+  std::string name;
+  std::string error;
+  SharedFrameHeader* header = nullptr;
+  unsigned char* base = nullptr;
+  std::size_t bytes = 0;
+  std::uint64_t frame = 0;	// being written
+};
+
+// Consumer side, mapping the object read only
+class SharedFrameReader {
+public:
+  explicit SharedFrameReader(const std::string& name);
+  ~SharedFrameReader();
+
+  SharedFrameReader(const SharedFrameReader&) = delete;
+  SharedFrameReader& operator=(const SharedFrameReader&) = delete;
+
+  bool valid() const { return header; }
+  const std::string& getError() const { return error; }
+  const SharedFrameHeader& getHeader() const { return *header; }
+
+  // A frame being read in place. Valid until the writer comes back around
+  // to its slot; check consistent() after using the pixels.
+  struct Frame {
+    std::uint64_t number = 0;	// 0 when there is no frame yet
+    std::uint64_t sequence = 0;
+    const SharedFrameSlot* slot = nullptr;
+    const float* pixels = nullptr;
+  };
+
+  // the newest finished frame
+  Frame latest() const;
+  // whether frame's pixels were left alone while they were used
+  bool consistent(const Frame& frame) const;
+
+private:
+  std::string error;
+  const SharedFrameHeader* header = nullptr;
+  const unsigned char* base = nullptr;
+  std::size_t bytes = 0;
+};
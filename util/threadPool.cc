@@ -0,0 +1,46 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "threadPool.hh"
+
+#include <string>
+
+#include "trace/trace.hh"
+
+ThreadPool::ThreadPool(unsigned threads) : stopping(false) {
+  if (threads == 0)
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  for (unsigned i = 0; i < threads; ++i)
+    workers.emplace_back(&ThreadPool::work, this, i);
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  for (auto& worker : workers)
+    worker.join();
+}
+
+void ThreadPool::work(unsigned index) {
+  Trace::setThreadName("worker " + std::to_string(index));
+  for (;;) {
+    std::function<void()> job;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this]() { return stopping || !jobs.empty(); });
+      if (jobs.empty())
+        return;
+      job = std::move(jobs.front());
+      jobs.pop();
+    }
+    job();
+  }
+}
@@ -0,0 +1,53 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running submitted jobs in FIFO order
+class ThreadPool {
+public:
+  // 0 picks one thread per hardware thread
+  explicit ThreadPool(unsigned threads = 0);
+  // finishes the queued jobs, then joins the workers
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  template <typename Job>
+  auto submit(Job job) -> std::future<decltype(job())> {
+    auto task = std::make_shared<std::packaged_task<decltype(job())()>>(std::move(job));
+    auto result = task->get_future();
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      jobs.push([task]() { (*task)(); });
+    }
+    wake.notify_one();
+    return result;
+  }
+
+  unsigned size() const { return workers.size(); }
+
+private:
+  std::vector<std::thread> workers;
+  std::queue<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable wake;
+  bool stopping;
+
+  void work(unsigned index);
+};
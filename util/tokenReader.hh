@@ -0,0 +1,89 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cctype>
+#include <cstddef>
+#include <cstdlib>
+#include <string>
+
+// Reads whitespace separated tokens out of a character range, like
+// operator>> on an istream but without the locale and stream overhead.
+// Once a token is missing or malformed, fail is set and stays set.
+struct TokenReader {
+  TokenReader(const char* begin, const char* end) : position(begin), end(end) {}
+
+  const char* position;
+  const char* end;
+  bool fail = false;
+
+  bool atEnd() {
+    skipSpace();
+    return position == end;
+  }
+
+  std::string nextWord() {
+    skipSpace();
+    const char* start = position;
+    skipWord();
+    if (start == position)
+      fail = true;
+    return std::string(start, position);
+  }
+
+  float nextFloat() {
+    return (float)nextNumber(false);
+  }
+
+  // like operator>> into an int, "10.0" reads as 10
+  int nextInt() {
+    return (int)nextNumber(true);
+  }
+
+  // step over count tokens without converting them
+  void skip(std::size_t count) {
+    for (std::size_t i = 0; i < count && !fail; ++i) {
+      skipSpace();
+      if (position == end)
+        fail = true;
+      skipWord();
+    }
+  }
+
+private:
+  void skipSpace() {
+    while (position != end && std::isspace((unsigned char)*position))
+      ++position;
+  }
+
+  void skipWord() {
+    while (position != end && !std::isspace((unsigned char)*position))
+      ++position;
+  }
+
+  double nextNumber(bool integer) {
+    skipSpace();
+    const char* start = position;
+    skipWord();
+    // tokens are short, copy so strtod never reads past the range
+    char token[64];
+    std::size_t length = position - start;
+    if (length == 0 || length >= sizeof(token)) {
+      fail = true;
+      return 0;
+    }
+    std::string(start, length).copy(token, length);
+    token[length] = '\0';
+    char* parsed;
+    double value = integer ? (double)std::strtol(token, &parsed, 10) : std::strtod(token, &parsed);
+    if (parsed == token)
+      fail = true;
+    return value;
+  }
+};
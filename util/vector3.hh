@@ -47,7 +47,7 @@ inline void operator-=(Vector3& lhs, Vector3 rhs) {
 }
 
 inline Vector3 operator+(Vector3 lhs, Vector3 rhs) {
-  return lhs - (-rhs);
+  return { lhs.x + rhs.x, lhs.y + rhs.y, lhs.z + rhs.z };
 }
 
 inline void operator+=(Vector3& lhs, Vector3 rhs) {
@@ -110,6 +110,10 @@ inline Vector3 normalize(Vector3 vector) {
   return result;
 }
 
+inline Vector3 lerp(Vector3 a, Vector3 b, float t) {
+  return a + (b - a) * t;
+}
+
 inline Vector3 clamp(int min, int max, Vector3 vector) {
   Vector3 result = {
     clamp(min, max, vector.x),
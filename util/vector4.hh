@@ -0,0 +1,135 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Four floats operated on lane by lane, with SSE2 or AArch64 NEON when the
+// compiler targets them and plain loops otherwise (or with
+// -DA5_SCALAR_MATH). Every operation is a single correctly rounded IEEE
+// operation per lane, so results match the same float code written out
+// per lane bit for bit.
+#if !defined(A5_SCALAR_MATH) && defined(__SSE2__)
+#define A5_VECTOR4_SSE
+#include <emmintrin.h>
+#elif !defined(A5_SCALAR_MATH) && defined(__aarch64__) && defined(__ARM_NEON)
+#define A5_VECTOR4_NEON
+#include <arm_neon.h>
+#endif
+
+struct Vector4 {
+#if defined(A5_VECTOR4_SSE)
+  __m128 v;
+#elif defined(A5_VECTOR4_NEON)
+  float32x4_t v;
+#else
+  float v[4];
+#endif
+
+  static Vector4 load(const float* p) {
+#if defined(A5_VECTOR4_SSE)
+    return { _mm_loadu_ps(p) };
+#elif defined(A5_VECTOR4_NEON)
+    return { vld1q_f32(p) };
+#else
+    return { { p[0], p[1], p[2], p[3] } };
+#endif
+  }
+
+  static Vector4 broadcast(float value) {
+#if defined(A5_VECTOR4_SSE)
+    return { _mm_set1_ps(value) };
+#elif defined(A5_VECTOR4_NEON)
+    return { vdupq_n_f32(value) };
+#else
+    return { { value, value, value, value } };
+#endif
+  }
+
+  void store(float* p) const {
+#if defined(A5_VECTOR4_SSE)
+    _mm_storeu_ps(p, v);
+#elif defined(A5_VECTOR4_NEON)
+    vst1q_f32(p, v);
+#else
+    std::memcpy(p, v, sizeof v);
+#endif
+  }
+};
+
+#if defined(A5_VECTOR4_SSE)
+
+inline Vector4 operator+(Vector4 lhs, Vector4 rhs) { return { _mm_add_ps(lhs.v, rhs.v) }; }
+inline Vector4 operator-(Vector4 lhs, Vector4 rhs) { return { _mm_sub_ps(lhs.v, rhs.v) }; }
+inline Vector4 operator*(Vector4 lhs, Vector4 rhs) { return { _mm_mul_ps(lhs.v, rhs.v) }; }
+inline Vector4 operator/(Vector4 lhs, Vector4 rhs) { return { _mm_div_ps(lhs.v, rhs.v) }; }
+inline Vector4 sqrt(Vector4 vector) { return { _mm_sqrt_ps(vector.v) }; }
+// all bits set in the lanes where lhs > rhs
+inline Vector4 greaterThan(Vector4 lhs, Vector4 rhs) { return { _mm_cmpgt_ps(lhs.v, rhs.v) }; }
+// lanes of a where mask is set, of b elsewhere
+inline Vector4 select(Vector4 mask, Vector4 a, Vector4 b) {
+  return { _mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v)) };
+}
+
+#elif defined(A5_VECTOR4_NEON)
+
+inline Vector4 operator+(Vector4 lhs, Vector4 rhs) { return { vaddq_f32(lhs.v, rhs.v) }; }
+inline Vector4 operator-(Vector4 lhs, Vector4 rhs) { return { vsubq_f32(lhs.v, rhs.v) }; }
+inline Vector4 operator*(Vector4 lhs, Vector4 rhs) { return { vmulq_f32(lhs.v, rhs.v) }; }
+inline Vector4 operator/(Vector4 lhs, Vector4 rhs) { return { vdivq_f32(lhs.v, rhs.v) }; }
+inline Vector4 sqrt(Vector4 vector) { return { vsqrtq_f32(vector.v) }; }
+inline Vector4 greaterThan(Vector4 lhs, Vector4 rhs) {
+  return { vreinterpretq_f32_u32(vcgtq_f32(lhs.v, rhs.v)) };
+}
+inline Vector4 select(Vector4 mask, Vector4 a, Vector4 b) {
+  return { vbslq_f32(vreinterpretq_u32_f32(mask.v), a.v, b.v) };
+}
+
+#else
+
+#define A5_VECTOR4_LANES(expression) \
+  Vector4 result; \
+  for (int i = 0; i < 4; ++i) \
+    result.v[i] = expression; \
+  return result
+
+inline Vector4 operator+(Vector4 lhs, Vector4 rhs) { A5_VECTOR4_LANES(lhs.v[i] + rhs.v[i]); }
+inline Vector4 operator-(Vector4 lhs, Vector4 rhs) { A5_VECTOR4_LANES(lhs.v[i] - rhs.v[i]); }
+inline Vector4 operator*(Vector4 lhs, Vector4 rhs) { A5_VECTOR4_LANES(lhs.v[i] * rhs.v[i]); }
+inline Vector4 operator/(Vector4 lhs, Vector4 rhs) { A5_VECTOR4_LANES(lhs.v[i] / rhs.v[i]); }
+inline Vector4 sqrt(Vector4 vector) { A5_VECTOR4_LANES(std::sqrt(vector.v[i])); }
+
+inline Vector4 greaterThan(Vector4 lhs, Vector4 rhs) {
+  Vector4 result;
+  for (int i = 0; i < 4; ++i) {
+    std::uint32_t bits = lhs.v[i] > rhs.v[i] ? 0xffffffffu : 0;
+    std::memcpy(&result.v[i], &bits, sizeof bits);
+  }
+  return result;
+}
+
+inline Vector4 select(Vector4 mask, Vector4 a, Vector4 b) {
+  Vector4 result;
+  for (int i = 0; i < 4; ++i) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &mask.v[i], sizeof bits);
+    result.v[i] = bits ? a.v[i] : b.v[i];
+  }
+  return result;
+}
+
+#undef A5_VECTOR4_LANES
+
+#endif
+
+inline void operator+=(Vector4& lhs, Vector4 rhs) { lhs = lhs + rhs; }
+inline void operator-=(Vector4& lhs, Vector4 rhs) { lhs = lhs - rhs; }
+inline Vector4 operator*(Vector4 lhs, float rhs) { return lhs * Vector4::broadcast(rhs); }
@@ -0,0 +1,88 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include "util/vector3.hh"
+#include "util/vector4.hh"
+
+// Vector3 operations over arrays laid out structure-of-arrays, four
+// vectors at a time in Vector4 lanes. Each result is bitwise what the
+// Vector3 function of the same name gives for that element.
+
+// count vectors, the i-th being (x[i], y[i], z[i])
+struct Vector3Batch {
+  float* x;
+  float* y;
+  float* z;
+
+  Vector3 get(int i) const { return { x[i], y[i], z[i] }; }
+  void set(int i, Vector3 vector) const {
+    x[i] = vector.x;
+    y[i] = vector.y;
+    z[i] = vector.z;
+  }
+};
+
+// out may be in
+inline void normalize(Vector3Batch in, Vector3Batch out, int count) {
+  int i = 0;
+  Vector4 zero = Vector4::broadcast(0);
+  for (; i + 4 <= count; i += 4) {
+    Vector4 x = Vector4::load(in.x + i);
+    Vector4 y = Vector4::load(in.y + i);
+    Vector4 z = Vector4::load(in.z + i);
+    Vector4 mag = sqrt(x * x + y * y + z * z);
+    Vector4 positive = greaterThan(mag, zero);
+    select(positive, x / mag, zero).store(out.x + i);
+    select(positive, y / mag, zero).store(out.y + i);
+    select(positive, z / mag, zero).store(out.z + i);
+  }
+  for (; i < count; ++i)
+    out.set(i, normalize(in.get(i)));
+}
+
+inline void dot(Vector3Batch u, Vector3Batch v, float* out, int count) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    Vector4 result = Vector4::load(u.x + i) * Vector4::load(v.x + i)
+                   + Vector4::load(u.y + i) * Vector4::load(v.y + i)
+                   + Vector4::load(u.z + i) * Vector4::load(v.z + i);
+    result.store(out + i);
+  }
+  for (; i < count; ++i)
+    out[i] = dot(u.get(i), v.get(i));
+}
+
+// out may not be u or v
+inline void cross(Vector3Batch u, Vector3Batch v, Vector3Batch out, int count) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    Vector4 ux = Vector4::load(u.x + i), uy = Vector4::load(u.y + i), uz = Vector4::load(u.z + i);
+    Vector4 vx = Vector4::load(v.x + i), vy = Vector4::load(v.y + i), vz = Vector4::load(v.z + i);
+    (uy * vz - uz * vy).store(out.x + i);
+    (uz * vx - ux * vz).store(out.y + i);
+    (ux * vy - uy * vx).store(out.z + i);
+  }
+  for (; i < count; ++i)
+    out.set(i, cross(u.get(i), v.get(i)));
+}
+
+// a + (b - a) * t[i]; out may be a or b
+inline void lerp(Vector3Batch a, Vector3Batch b, const float* t, Vector3Batch out, int count) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    Vector4 weight = Vector4::load(t + i);
+    Vector4 ax = Vector4::load(a.x + i), ay = Vector4::load(a.y + i), az = Vector4::load(a.z + i);
+    (ax + (Vector4::load(b.x + i) - ax) * weight).store(out.x + i);
+    (ay + (Vector4::load(b.y + i) - ay) * weight).store(out.y + i);
+    (az + (Vector4::load(b.z + i) - az) * weight).store(out.z + i);
+  }
+  for (; i < count; ++i)
+    out.set(i, lerp(a.get(i), b.get(i), t[i]));
+}
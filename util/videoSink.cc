@@ -0,0 +1,230 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#include "videoSink.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <unistd.h>
+
+#include "clamp.hh"
+#include "trace/trace.hh"
+#include "vector4.hh"
+
+namespace {
+
+// BT.601 weights of r, g and b scaled to video range: luma spans 219
+// levels above 16, chroma 224 levels around 128
+const float lumaWeights[3] = { 0.299f * 219, 0.587f * 219, 0.114f * 219 };
+const float blueWeights[3] = { -0.168736f * 224, -0.331264f * 224, 0.5f * 224 };
+const float redWeights[3] = { 0.5f * 224, -0.418688f * 224, -0.081312f * 224 };
+
+// works on floats and Vector4 alike, so the vector loop and its scalar
+// tail round the same way
+template <typename T>
+T weigh(T r, T g, T b, const float* weights) {
+  return r * weights[0] + g * weights[1] + b * weights[2];
+}
+
+unsigned char toByte(float value) {
+  return (unsigned char)(value + 0.5f);
+}
+
+// One frame in the layout of the output format
+class Converter {
+public:
+  Converter(int width, int height)
+    : width(width), height(height), chromaWidth((width + 1) / 2),
+      r(width), g(width), b(width), luma(width), blue(width), red(width),
+      blueSum(width), redSum(width) {}
+
+  // y, then u and v planes of (width + 1) / 2 by (height + 1) / 2
+  void yuv420(const float* rgb, std::vector<unsigned char>& frame) {
+    frame.resize(width * height + 2 * chromaWidth * ((height + 1) / 2));
+    unsigned char* y = frame.data();
+    unsigned char* u = y + width * height;
+    unsigned char* v = u + chromaWidth * ((height + 1) / 2);
+    for (int row = 0; row < height; ++row) {
+      split(rgb + (std::size_t)(height - 1 - row) * width * 3);
+      int x = 0;
+      for (; x + 4 <= width; x += 4) {
+        Vector4 vr = Vector4::load(&r[x]), vg = Vector4::load(&g[x]), vb = Vector4::load(&b[x]);
+        weigh(vr, vg, vb, lumaWeights).store(&luma[x]);
+        weigh(vr, vg, vb, blueWeights).store(&blue[x]);
+        weigh(vr, vg, vb, redWeights).store(&red[x]);
+      }
+      for (; x < width; ++x) {
+        luma[x] = weigh(r[x], g[x], b[x], lumaWeights);
+        blue[x] = weigh(r[x], g[x], b[x], blueWeights);
+        red[x] = weigh(r[x], g[x], b[x], redWeights);
+      }
+      for (x = 0; x < width; ++x)
+        y[row * width + x] = toByte(luma[x] + 16);
+
+      // chroma is the mean of each 2x2 block, edges repeating the last
+      // row or column
+      bool first = row % 2 == 0;
+      for (x = 0; x < width; ++x) {
+        blueSum[x] = first ? blue[x] : blueSum[x] + blue[x];
+        redSum[x] = first ? red[x] : redSum[x] + red[x];
+      }
+      if (first && row + 1 < height)
+        continue;
+      float rows = first ? 1 : 2;
+      int offset = row / 2 * chromaWidth;
+      for (int cx = 0; cx < chromaWidth; ++cx) {
+        int left = 2 * cx, right = std::min(left + 1, width - 1);
+        u[offset + cx] = toByte((blueSum[left] + blueSum[right]) / (2 * rows) + 128);
+        v[offset + cx] = toByte((redSum[left] + redSum[right]) / (2 * rows) + 128);
+      }
+    }
+  }
+
+  // rgb rows top to bottom
+  void rgb8(const float* rgb, std::vector<unsigned char>& frame) {
+    frame.resize(width * height * 3);
+    for (int row = 0; row < height; ++row) {
+      const float* source = rgb + (std::size_t)(height - 1 - row) * width * 3;
+      unsigned char* target = &frame[row * width * 3];
+      for (int i = 0; i < width * 3; ++i)
+        target[i] = (unsigned char)(clamp(0, 1, source[i]) * 255 + 0.5f);
+    }
+  }
+
+private:
+  int width, height, chromaWidth;
+  // one row split into channels, its luma and chroma, and the chroma of
+  // the pending row pair
+  std::vector<float> r, g, b, luma, blue, red, blueSum, redSum;
+
+  void split(const float* source) {
+    for (int x = 0; x < width; ++x) {
+      r[x] = clamp(0, 1, source[x * 3]);
+      g[x] = clamp(0, 1, source[x * 3 + 1]);
+      b[x] = clamp(0, 1, source[x * 3 + 2]);
+    }
+  }
+};
+
+}
+
+bool parseVideoFormat(const std::string& name, VideoFormat& format) {
+  if (name == "y4m")
+    format = VideoFormat::Y4M;
+  else if (name == "rgb")
+    format = VideoFormat::RGB;
+  else
+    return false;
+  return true;
+}
+
+VideoSink::VideoSink(const std::string& path, VideoFormat format, int width, int height,
+                     float fps)
+  : format(format), width(width), height(height)
+{
+  if (path == "-") {
+    // keep the pipe to ourselves: messages printed from here on go to stderr
+    int fd = dup(STDOUT_FILENO);
+    if (fd >= 0 && dup2(STDERR_FILENO, STDOUT_FILENO) >= 0)
+      out = fdopen(fd, "wb");
+  } else {
+    out = fopen(path.c_str(), "wb");
+  }
+  if (!out) {
+    error = "Could not open " + path + ": " + strerror(errno);
+    return;
+  }
+
+  if (format == VideoFormat::Y4M) {
+    // the frame rate as a fraction, exact for whole and most decimal rates
+    long rate = std::lround(fps * 1000);
+    long scale = 1000;
+    while (scale > 1 && rate % 10 == 0) {
+      rate /= 10;
+      scale /= 10;
+    }
+    fprintf(out, "YUV4MPEG2 W%d H%d F%ld:%ld Ip A1:1 C420jpeg\n", width, height, rate, scale);
+  }
+  frames.resize(queueFrames, std::vector<float>((std::size_t)width * height * 3));
+  for (auto& frame : frames)
+    spare.push_back(frame.data());
+  thread = std::thread(&VideoSink::run, this);
+}
+
+VideoSink::~VideoSink() {
+  finish();
+}
+
+void VideoSink::submit(const float* rgb) {
+  float* frame;
+  {
+    std::unique_lock<std::mutex> lock(mutex);
+    wake.wait(lock, [this]() { return !spare.empty(); });
+    frame = spare.back();
+    spare.pop_back();
+  }
+  std::memcpy(frame, rgb, frames[0].size() * sizeof(float));
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    queued.push_back(frame);
+  }
+  wake.notify_all();
+}
+
+bool VideoSink::finish() {
+  if (!out)
+    return false;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping = true;
+  }
+  wake.notify_all();
+  thread.join();
+  if (fclose(out) != 0)
+    failed = true;
+  out = nullptr;
+  return !failed;
+}
+
+void VideoSink::run() {
+  Trace::setThreadName("video");
+  Converter converter(width, height);
+  std::vector<unsigned char> frame;
+  for (;;) {
+    float* rgb;
+    {
+      std::unique_lock<std::mutex> lock(mutex);
+      wake.wait(lock, [this]() { return stopping || !queued.empty(); });
+      if (queued.empty())
+        return;
+      rgb = queued.front();
+      queued.pop_front();
+    }
+    {
+      TRACE_SCOPE("encode");
+      if (format == VideoFormat::Y4M) {
+        converter.yuv420(rgb, frame);
+        fputs("FRAME\n", out);
+      } else {
+        converter.rgb8(rgb, frame);
+      }
+    }
+    {
+      TRACE_SCOPE("write");
+      if (fwrite(frame.data(), 1, frame.size(), out) != frame.size())
+        failed = true;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      spare.push_back(rgb);
+    }
+    wake.notify_all();
+  }
+}
@@ -0,0 +1,67 @@
+//  Copyright 2016 Martin Fracker, Jr.
+//  All Rights Reserved.
+// 
+//  This project is free software, released under the terms
+//  of the GNU General Public License v3. Please see the
+//  file LICENSE in the root directory or visit
+//  www.gnu.org/licenses/gpl-3.0.en.html for license terms.
+
+#pragma once
+
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Y4M is 8-bit YUV 4:2:0 (BT.601, video range), raw is 8-bit rgb
+// frames back to back with no header
+enum class VideoFormat { Y4M, RGB };
+
+// accepts "y4m" or "rgb"
+bool parseVideoFormat(const std::string& name, VideoFormat& format);
+
+// Streams frames to a file, or to stdout for "-", for piping into an
+// encoder. Frames are copied into a queue and converted and written on a
+// thread of their own, so the renderer moves on to the next frame while
+// the last one is encoded; it only waits when the queue is full.
+class VideoSink {
+public:
+  // With "-" as path, stdout is kept for the video and whatever the
+  // program prints afterwards goes to stderr.
+  VideoSink(const std::string& path, VideoFormat format, int width, int height, float fps);
+  // writes out the queued frames
+  ~VideoSink();
+
+  VideoSink(const VideoSink&) = delete;
+  VideoSink& operator=(const VideoSink&) = delete;
+
+  // false with error set when the output could not be opened
+  bool valid() const { return out; }
+  const std::string& getError() const { return error; }
+
+  // queues width * height float rgb pixels, rows bottom to top
+  void submit(const float* rgb);
+  // writes out the queued frames, returning false if any write failed
+  bool finish();
+
+private:
+  static const int queueFrames = 2;
+
+  VideoFormat format;
+  int width, height;
+  std::string error;
+  FILE* out = nullptr;
+  bool failed = false;
+  bool stopping = false;
+  std::vector<std::vector<float>> frames;
+  std::vector<float*> spare;	// frames ready to be filled
+  std::deque<float*> queued;	// filled, in order
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::thread thread;
+
+  void run();
+};